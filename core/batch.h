@@ -0,0 +1,220 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <stdint.h>
+#include <immintrin.h>
+#include "item.h"
+#include "kernel.h"
+#include "fixed_capacity.h"
+
+// Many small independent instances in lockstep.
+//
+// Up to BATCH_LANES instances share one row, interleaved so column j of every
+// instance sits in one 64-byte line: row[j * BATCH_LANES + lane]. Step i
+// applies item i of every instance at once, walking j down in place as the
+// dp engine does:
+//
+//   row[j][l] = max(row[j][l], row[j - w_l][l] + v_l)    if w_l <= j
+//
+// Each lane has its own weight, so the take is a gather of 16 (AVX-512) or
+// two of 8 (AVX2) at offsets (j - w_l) * BATCH_LANES + l, masked off where
+// the item does not fit. Instances with fewer items are padded with items
+// that never fit. The row is as long as the largest capacity of the group,
+// and each lane reads its answer at its own capacity.
+//
+// A gather costs far more than a contiguous load, so lockstep only pays
+// while rows are too short for the row kernels to fill a vector. Groups
+// whose capacity is over BATCH_LOCKSTEP_MAX run one instance at a time
+// instead, on knapsack_fixed<C> up to FIXED_CAPACITY_MAX and on the row
+// kernels over one reused row past it.
+//
+// knapsack_batch() takes any number of instances and runs groups of
+// BATCH_LANES. Within each window of BATCH_WINDOW instances the ones small
+// enough for lockstep come first, sorted by capacity so a group pads as
+// little as possible, and the rest keep their order. The window's items stay
+// in cache throughout. It allocates one row for all groups and prints
+// nothing.
+const int BATCH_LANES = 16;
+const int BATCH_WINDOW = 16 * BATCH_LANES;
+const int BATCH_LOCKSTEP_MAX = 32;
+
+// One group in lane order, padded to BATCH_LANES
+struct BatchGroup
+{
+    int capacity;                  // largest capacity in the group
+    int steps;                     // items per lane after padding
+    std::vector<int> weight;       // steps x BATCH_LANES, over capacity when padding
+    std::vector<int> value;        // steps x BATCH_LANES
+    int answer_column[BATCH_LANES];
+    int weightless[BATCH_LANES];   // what weightless items add to the answer
+};
+
+// Fill `g` for the instances member[0 .. count), reusing its buffers
+inline void batch_group(BatchGroup &g, const std::vector<std::vector<Item>> &items, const std::vector<int> &capacities,
+                        const int *member, int count)
+{
+    g.capacity = 0;
+    g.steps = 0;
+    for (int l = 0; l < count; l++)
+    {
+        g.capacity = std::max(g.capacity, capacities[member[l]]);
+        g.steps = std::max(g.steps, (int)items[member[l]].size());
+    }
+    g.weight.assign((size_t)g.steps * BATCH_LANES, g.capacity + 1);
+    g.value.assign((size_t)g.steps * BATCH_LANES, 0);
+
+    for (int l = 0; l < BATCH_LANES; l++)
+    {
+        g.answer_column[l] = l < count ? std::max(0, capacities[member[l]]) : 0;
+        g.weightless[l] = l < count ? weightless_value(items[member[l]], capacities[member[l]]) : 0;
+        for (int i = 0; l < count && i < (int)items[member[l]].size(); i++)
+        {
+            const Item &item = items[member[l]][i];
+            if (item.value <= 0 || item.weight > capacities[member[l]] || is_weightless(item))
+            {
+                continue;
+            }
+            g.weight[(size_t)i * BATCH_LANES + l] = item.weight;
+            g.value[(size_t)i * BATCH_LANES + l] = item.value;
+        }
+    }
+}
+
+inline void batch_step_scalar(int *row, int capacity, const int *weight, const int *value)
+{
+    for (int j = capacity; j >= 1; j--)
+    {
+        int *cell = row + (size_t)j * BATCH_LANES;
+        for (int l = 0; l < BATCH_LANES; l++)
+        {
+            if (weight[l] <= j)
+            {
+                cell[l] = std::max(cell[l], cell[l - weight[l] * BATCH_LANES] + value[l]);
+            }
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+inline void batch_step_avx2(int *row, int capacity, const int *weight, const int *value)
+{
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    for (int half = 0; half < BATCH_LANES; half += 8)
+    {
+        const __m256i w = _mm256_loadu_si256((const __m256i *)(weight + half));
+        const __m256i v = _mm256_loadu_si256((const __m256i *)(value + half));
+        // offset of row[j - w] from row[j], per lane
+        const __m256i back = _mm256_sub_epi32(lane, _mm256_slli_epi32(w, 4));
+        for (int j = capacity; j >= 1; j--)
+        {
+            int *cell = row + (size_t)j * BATCH_LANES + half;
+            const __m256i fits = _mm256_cmpgt_epi32(_mm256_set1_epi32(j + 1), w);
+            const __m256i skip = _mm256_loadu_si256((const __m256i *)cell);
+            const __m256i take = _mm256_add_epi32(_mm256_mask_i32gather_epi32(skip, cell, back, fits, 4), v);
+            _mm256_storeu_si256((__m256i *)cell, _mm256_blendv_epi8(skip, _mm256_max_epi32(skip, take), fits));
+        }
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void batch_step_avx512(int *row, int capacity, const int *weight, const int *value)
+{
+    const __m512i w = _mm512_loadu_si512((const void *)weight);
+    const __m512i v = _mm512_loadu_si512((const void *)value);
+    const __m512i back = _mm512_sub_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+                                          _mm512_slli_epi32(w, 4));
+    for (int j = capacity; j >= 1; j--)
+    {
+        int *cell = row + (size_t)j * BATCH_LANES;
+        const __mmask16 fits = _mm512_cmple_epi32_mask(w, _mm512_set1_epi32(j));
+        const __m512i skip = _mm512_loadu_si512((const void *)cell);
+        const __m512i take = _mm512_add_epi32(_mm512_mask_i32gather_epi32(skip, fits, back, cell, 4), v);
+        _mm512_storeu_si512((void *)cell, _mm512_mask_max_epi32(skip, fits, skip, take));
+    }
+}
+
+typedef void (*BatchStep)(int *row, int capacity, const int *weight, const int *value);
+
+// Step kernel at the ISA level of the active kernel
+inline BatchStep batch_step()
+{
+    if (active_kernel.level == 2)
+    {
+        return batch_step_avx512;
+    }
+    if (active_kernel.level == 1)
+    {
+        return batch_step_avx2;
+    }
+    return batch_step_scalar;
+}
+
+// One instance on its own, `row` reused between calls
+inline int batch_single(const std::vector<Item> &items, int capacity, std::vector<int> &row)
+{
+    if (capacity <= FIXED_CAPACITY_MAX)
+    {
+        return capacity < 1 ? 0 : knapsack_fixed_capacity(items, capacity);
+    }
+    row.assign(capacity + 1, 0);
+    for (const Item &item : items)
+    {
+        if (item.value <= 0 || item.weight > capacity || is_weightless(item))
+        {
+            continue;
+        }
+        row_update_inplace(row.data(), item.weight, capacity, item.weight, item.value);
+    }
+    return row[capacity] + weightless_value(items, capacity);
+}
+
+// Best value of every instance, in input order
+inline std::vector<int> knapsack_batch(const std::vector<std::vector<Item>> &items, const std::vector<int> &capacities)
+{
+    const int count = capacities.size();
+    std::vector<int> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    for (int first = 0; first < count; first += BATCH_WINDOW)
+    {
+        std::vector<int>::iterator begin = order.begin() + first, end = order.begin() + std::min(count, first + BATCH_WINDOW);
+        std::vector<int>::iterator small = std::stable_partition(begin, end, [&](int i) {
+            return capacities[i] <= BATCH_LOCKSTEP_MAX;
+        });
+        std::sort(begin, small, [&](int a, int b) { return capacities[a] < capacities[b]; });
+    }
+
+    const BatchStep step = batch_step();
+    std::vector<int> best(count, 0);
+    std::vector<int> row;
+    BatchGroup g;
+    for (int first = 0; first < count; first += BATCH_LANES)
+    {
+        const int lanes = std::min(BATCH_LANES, count - first);
+        if (capacities[order[first + lanes - 1]] > BATCH_LOCKSTEP_MAX)
+        {
+            for (int l = 0; l < lanes; l++)
+            {
+                best[order[first + l]] = batch_single(items[order[first + l]], capacities[order[first + l]], row);
+            }
+            continue;
+        }
+
+        batch_group(g, items, capacities, order.data() + first, lanes);
+        row.assign((size_t)(g.capacity + 1) * BATCH_LANES, 0);
+        for (int i = 0; i < g.steps; i++)
+        {
+            step(row.data(), g.capacity, &g.weight[(size_t)i * BATCH_LANES], &g.value[(size_t)i * BATCH_LANES]);
+        }
+
+        for (int l = 0; l < lanes; l++)
+        {
+            best[order[first + l]] = row[(size_t)g.answer_column[l] * BATCH_LANES + l] + g.weightless[l];
+        }
+    }
+    return best;
+}
+
+#endif // BATCH_H
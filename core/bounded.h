@@ -0,0 +1,146 @@
+#ifndef BOUNDED_H
+#define BOUNDED_H
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+#include "item.h"
+#include "kernel.h"
+
+// Bounded knapsack: `count` interchangeable copies of one item.
+//
+// Along a residue class j = r + t w the update over up to c copies is
+//
+//   dp'[r + t w] = max_{t-c <= s <= t} dp[r + s w] + (t - s) v
+//                = t v + max_{t-c <= s <= t} (dp[r + s w] - s v)
+//
+// a sliding window maximum, kept in a monotone deque in O(1) amortised per
+// column. A group therefore costs one O(C) pass however many copies it has.
+struct BoundedItem
+{
+    int weight;
+    int value;
+    int count;
+
+    BoundedItem(int w, int v, int c) : weight(w), value(v), count(c) {}
+    BoundedItem() : weight(0), value(0), count(0) {}
+};
+
+// Groups of at most this many copies are applied copy by copy with the row
+// kernel, which beats the deque's per-column bookkeeping for a few passes
+#ifndef BOUNDED_SWEEP_COPIES
+#define BOUNDED_SWEEP_COPIES 32
+#endif
+
+// Collapse identical (weight, value) pairs, summing their counts. Groups come
+// out in order of first appearance. Items given one by one are count 1.
+inline std::vector<BoundedItem> merge_duplicates(const std::vector<BoundedItem> &items)
+{
+    std::vector<BoundedItem> groups;
+    std::map<std::pair<int, int>, int> slot;
+
+    for (const BoundedItem &item : items)
+    {
+        if (item.count <= 0)
+        {
+            continue;
+        }
+
+        auto key = std::make_pair(item.weight, item.value);
+        auto found = slot.find(key);
+        if (found == slot.end())
+        {
+            slot[key] = groups.size();
+            groups.push_back(item);
+        }
+        else
+        {
+            groups[found->second].count += item.count;
+        }
+    }
+
+    return groups;
+}
+
+inline std::vector<BoundedItem> merge_duplicates(const std::vector<Item> &items)
+{
+    std::vector<BoundedItem> single;
+    single.reserve(items.size());
+    for (const Item &item : items)
+    {
+        single.push_back(BoundedItem(item.weight, item.value, 1));
+    }
+    return merge_duplicates(single);
+}
+
+// Apply `count` copies of one item to dp in place
+inline void bounded_update(std::vector<int> &dp, int capacity, int weight, int value, int count)
+{
+    if (count <= BOUNDED_SWEEP_COPIES)
+    {
+        for (int k = 0; k < count; k++)
+        {
+            row_update_inplace(dp.data(), 1, capacity, weight, value);
+        }
+        return;
+    }
+
+    // deque of positions s, with dp[r + s w] - s v decreasing front to back
+    std::vector<int> queue(capacity / weight + 1);
+    std::vector<long long> key(capacity / weight + 1);
+
+    for (int r = 0; r < weight && r <= capacity; r++)
+    {
+        int head = 0, tail = 0;
+        for (int t = 0, j = r; j <= capacity; t++, j += weight)
+        {
+            long long k = dp[j] - (long long)t * value;
+            while (tail > head && key[tail - 1] <= k)
+            {
+                tail--;
+            }
+            queue[tail] = t;
+            key[tail++] = k;
+
+            if (queue[head] < t - count)
+            {
+                head++;
+            }
+
+            // column 0 stays 0, as in every other engine
+            if (j > 0)
+            {
+                dp[j] = key[head] + (long long)t * value;
+            }
+        }
+    }
+}
+
+inline int knapsack_bounded(const std::vector<BoundedItem> &groups, int capacity)
+{
+    std::vector<int> dp(capacity + 1, 0);
+    long long weightless = 0;
+
+    for (const BoundedItem &group : groups)
+    {
+        if (group.value <= 0 || group.count <= 0 || group.weight > capacity)
+        {
+            continue;
+        }
+
+        if (group.weight <= 0)
+        {
+            weightless += (long long)group.value * group.count;
+            continue;
+        }
+
+        // no more than C / w copies fit
+        int count = std::min(group.count, capacity / group.weight);
+        bounded_update(dp, capacity, group.weight, group.value, count);
+    }
+
+    return dp[capacity] + weightless_gain(weightless, capacity);
+}
+
+#endif // BOUNDED_H
@@ -0,0 +1,246 @@
+#ifndef BRANCH_BOUND_H
+#define BRANCH_BOUND_H
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "item.h"
+
+// Depth-first branch and bound.
+//
+// Items are sorted by efficiency (value / weight, best first), so the LP
+// relaxation of a node is Dantzig's bound: the following items whole while
+// they fit plus a fraction of the first one that does not. With prefix sums
+// that is one binary search per node. A greedy pass seeds the incumbent.
+//
+// The tree is spread over std::thread workers. Each worker runs a DFS on a
+// private stack. While some worker is idle it moves the shallowest node of
+// that stack, the root of the largest untouched subtree, to its shared
+// deque. Idle workers pop their own deque from the back and steal from the
+// front of the others. The incumbent is a shared atomic, so a better
+// solution found anywhere prunes everywhere at once.
+struct BranchBoundStats
+{
+    long long nodes;     // nodes expanded over all workers
+    long long steals;    // nodes taken from another worker's deque
+    long long greedy;    // value of the warm start
+};
+
+class BranchBound
+{
+    public:
+
+    BranchBound(const std::vector<Item> &input, int capacity) : capacity(capacity)
+    {
+        for (const Item &item : input)
+        {
+            if (item.value > 0 && item.weight > 0 && item.weight <= capacity)
+            {
+                items.push_back(item);
+            }
+        }
+
+        std::stable_sort(items.begin(), items.end(), [](const Item &a, const Item &b) {
+            return (long long)a.value * b.weight > (long long)b.value * a.weight;
+        });
+
+        n = items.size();
+        weights.assign(n + 1, 0);
+        values.assign(n + 1, 0);
+        for (int i = 0; i < n; i++)
+        {
+            weights[i + 1] = weights[i] + items[i].weight;
+            values[i + 1] = values[i] + items[i].value;
+        }
+    }
+
+    long long solve(int nThreads, BranchBoundStats &stats)
+    {
+        nThreads = std::max(1, nThreads);
+
+        // greedy warm start: every item in efficiency order that still fits
+        long long room = capacity, greedy = 0;
+        for (const Item &item : items)
+        {
+            if (item.weight <= room)
+            {
+                room -= item.weight;
+                greedy += item.value;
+            }
+        }
+        incumbent = greedy;
+
+        queues = std::vector<WorkQueue>(nThreads);
+        queues[0].nodes.push_back(Node{0, capacity, 0});
+        pending = 1;
+        idle = 0;
+        nodes = 0;
+        steals = 0;
+
+        std::vector<std::thread> threads;
+        for (int id = 0; id < nThreads; id++)
+        {
+            threads.push_back(std::thread(&BranchBound::worker, this, id));
+        }
+        for (std::thread &t : threads)
+        {
+            t.join();
+        }
+
+        stats.nodes = nodes;
+        stats.steals = steals;
+        stats.greedy = greedy;
+        return incumbent;
+    }
+
+    private:
+
+    struct Node
+    {
+        int depth;       // items [0, depth) are decided
+        long long room;  // capacity left
+        long long value; // value taken so far
+    };
+
+    struct WorkQueue
+    {
+        std::deque<Node> nodes;
+        std::mutex lock;
+    };
+
+    std::vector<Item> items;
+    std::vector<long long> weights; // prefix sums in efficiency order
+    std::vector<long long> values;
+    int n;
+    int capacity;
+
+    std::atomic<long long> incumbent;
+    std::atomic<long long> pending; // nodes in deques or being expanded
+    std::atomic<int> idle;
+    std::atomic<long long> nodes;
+    std::atomic<long long> steals;
+    std::vector<WorkQueue> queues;
+
+    // Dantzig bound of a node
+    long long bound(const Node &node) const
+    {
+        int end = std::upper_bound(weights.begin() + node.depth, weights.end(), weights[node.depth] + node.room)
+                  - weights.begin() - 1;
+        long long b = node.value + values[end] - values[node.depth];
+        if (end < n)
+        {
+            long long left = node.room - (weights[end] - weights[node.depth]);
+            b += left * items[end].value / items[end].weight;
+        }
+        return b;
+    }
+
+    void offer(long long value)
+    {
+        long long best = incumbent.load();
+        while (value > best && !incumbent.compare_exchange_weak(best, value))
+        {
+        }
+    }
+
+    bool take_work(int id, Node &node)
+    {
+        {
+            std::lock_guard<std::mutex> guard(queues[id].lock);
+            if (!queues[id].nodes.empty())
+            {
+                node = queues[id].nodes.back();
+                queues[id].nodes.pop_back();
+                return true;
+            }
+        }
+
+        for (size_t k = 1; k < queues.size(); k++)
+        {
+            WorkQueue &victim = queues[(id + k) % queues.size()];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.nodes.empty())
+            {
+                node = victim.nodes.front();
+                victim.nodes.pop_front();
+                steals++;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void worker(int id)
+    {
+        std::deque<Node> stack;
+        long long expanded = 0;
+
+        while (pending.load() > 0)
+        {
+            Node start;
+            if (!take_work(id, start))
+            {
+                idle++;
+                while (pending.load() > 0 && !take_work(id, start))
+                {
+                    std::this_thread::yield();
+                }
+                idle--;
+                if (pending.load() == 0)
+                {
+                    break;
+                }
+            }
+
+            stack.push_back(start);
+            while (!stack.empty())
+            {
+                // hand the biggest open subtree to whoever is waiting
+                if (idle.load() > 0 && stack.size() > 1)
+                {
+                    pending++;
+                    std::lock_guard<std::mutex> guard(queues[id].lock);
+                    queues[id].nodes.push_back(stack.front());
+                    stack.pop_front();
+                }
+
+                Node node = stack.back();
+                stack.pop_back();
+                expanded++;
+
+                if (node.value > incumbent.load())
+                {
+                    offer(node.value);
+                }
+                if (node.depth == n || bound(node) <= incumbent.load())
+                {
+                    continue;
+                }
+
+                // skip below take, so the greedy-like branch is explored first
+                const Item &item = items[node.depth];
+                stack.push_back(Node{node.depth + 1, node.room, node.value});
+                if (item.weight <= node.room)
+                {
+                    stack.push_back(Node{node.depth + 1, node.room - item.weight, node.value + item.value});
+                }
+            }
+
+            pending--;
+        }
+
+        nodes += expanded;
+    }
+};
+
+inline int knapsack_branch_bound(const std::vector<Item> &items, int capacity, int nThreads, BranchBoundStats &stats)
+{
+    BranchBound search(items, capacity);
+    return search.solve(nThreads, stats) + weightless_value(items, capacity);
+}
+
+#endif // BRANCH_BOUND_H
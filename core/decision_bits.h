@@ -0,0 +1,99 @@
+#ifndef DECISION_BITS_H
+#define DECISION_BITS_H
+
+#include <algorithm>
+#include <vector>
+#include <stdint.h>
+#include <stdlib.h>
+#include "item.h"
+#include "kernel.h"
+
+// Bit-packed decision matrix: bit (i, j) is set when item i is taken at
+// capacity j in the forward pass. One bit per cell instead of a 32-bit value
+// (n = 100k, C = 1000 is 12.5 MB instead of 400 MB), and the chosen items come
+// straight out of a backtrack from column capacity.
+//
+// The matrix comes from calloc so large ones are mapped as zero pages and only
+// touched once, by the forward pass, instead of being cleared up front. When
+// calloc fails `bits` is null, and callers fall back to divide and conquer.
+struct DecisionBits
+{
+    int words;
+    uint64_t* bits;
+
+    DecisionBits(int n, int capacity) : words(capacity / 64 + 1)
+    {
+        bits = (uint64_t*)calloc((size_t)n * words + 1, sizeof(uint64_t));
+    }
+
+    ~DecisionBits()
+    {
+        free(bits);
+    }
+
+    DecisionBits(const DecisionBits&) = delete;
+    DecisionBits& operator=(const DecisionBits&) = delete;
+
+    static size_t bytes(int n, int capacity)
+    {
+        return (size_t)n * (capacity / 64 + 1) * sizeof(uint64_t);
+    }
+
+    uint64_t* row(int i)
+    {
+        return &bits[(size_t)i * words];
+    }
+
+    bool taken(int i, int j) const
+    {
+        return (bits[(size_t)i * words + (j >> 6)] >> (j & 63)) & 1;
+    }
+
+    // Indices (ascending) of the items taken on the way back from capacity
+    std::vector<int> backtrack(const std::vector<Item> &items, int capacity) const
+    {
+        std::vector<int> chosen;
+        int j = capacity;
+
+        for (int i = items.size() - 1; i >= 0; i--)
+        {
+            if (taken(i, j))
+            {
+                chosen.push_back(i);
+                j -= items[i].weight;
+            }
+        }
+
+        std::reverse(chosen.begin(), chosen.end());
+        return chosen;
+    }
+};
+
+// Single-row forward pass that records decisions, then backtracks into
+// `chosen`. Rows of weightless items take nothing, and the items are added
+// after the backtrack. Returns false if the matrix cannot be allocated.
+inline bool knapsack_decision_bits(const std::vector<Item> &items, int capacity, std::vector<int> &chosen)
+{
+    int n = items.size();
+    DecisionBits decisions(n, capacity);
+    if (!decisions.bits)
+    {
+        return false;
+    }
+    std::vector<int> dp(capacity + 1, 0);
+
+    for (int i = 0; i < n; i++)
+    {
+        if (!is_weightless(items[i]))
+        {
+            row_update_inplace_bits(dp.data(), 1, capacity, items[i].weight, items[i].value, decisions.row(i));
+        }
+    }
+
+    chosen = decisions.backtrack(items, capacity);
+    add_weightless(items, capacity, chosen);
+    std::sort(chosen.begin(), chosen.end());
+    return true;
+}
+
+#endif // DECISION_BITS_H
@@ -0,0 +1,108 @@
+#ifndef EARLY_EXIT_H
+#define EARLY_EXIT_H
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <vector>
+#include "item.h"
+
+// Early termination against the LP bound.
+//
+// DP(i, C) is a value some set of the first i items reaches. Once it equals
+// the Dantzig bound of the whole instance nothing can beat it, and the rows
+// left are skipped.
+//
+// Item k also gets a bound of its own on any solution that takes it. With
+// the break item's efficiency as the LP dual price, any set containing k is
+// worth at most
+//
+//   LP + min(0, v_k - w_k v_b / w_b)
+//
+// so when DP(i, C) reaches that, item k cannot lead to a better answer and
+// its row is copied instead of computed. Both checks run every `every` rows,
+// on the DP(i, C) of the last check, so every thread and rank decides the
+// same rows the same way.
+struct EarlyExit
+{
+    int every;                     // rows between checks, 0 when off
+    long long lp_bound;            // no set is worth more
+    std::vector<long long> bound;  // no set taking item i is worth more
+};
+
+inline EarlyExit early_exit(const std::vector<Item> &items, int capacity, int every)
+{
+    EarlyExit e;
+    e.every = std::max(0, every);
+    e.lp_bound = std::numeric_limits<long long>::max();
+    e.bound.assign(items.size(), e.lp_bound);
+    if (e.every == 0)
+    {
+        return e;
+    }
+
+    // weightless items never enter the rows, so the bounds leave them out
+    std::vector<Item> sorted;
+    for (const Item &item : items)
+    {
+        if (item.value > 0 && item.weight <= capacity && !is_weightless(item))
+        {
+            sorted.push_back(item);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Item &a, const Item &b) {
+        return (long long)a.value * b.weight > (long long)b.value * a.weight;
+    });
+
+    // Dantzig bound and the break item's efficiency
+    long double lp = 0, price = 0;
+    long long room = capacity;
+    for (const Item &item : sorted)
+    {
+        if (item.weight > room)
+        {
+            price = (long double)item.value / item.weight;
+            lp += room * price;
+            break;
+        }
+        room -= item.weight;
+        lp += item.value;
+    }
+
+    // a hair of slack, so rounding can only loosen a bound
+    e.lp_bound = std::floor(lp + 1e-6);
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        if (items[i].weight > capacity)
+        {
+            e.bound[i] = -1;
+        }
+        else if (items[i].weight > 0)
+        {
+            e.bound[i] = std::floor(lp + std::min((long double)0, items[i].value - items[i].weight * price) + 1e-6);
+        }
+    }
+
+    return e;
+}
+
+// Nothing is left to gain once the best value so far meets the LP bound
+inline bool reached_bound(const EarlyExit &e, long long best)
+{
+    return e.every > 0 && best >= e.lp_bound;
+}
+
+// Row i cannot improve on `best`
+inline bool skip_item(const EarlyExit &e, int i, long long best)
+{
+    return e.every > 0 && e.bound[i] <= best;
+}
+
+inline void print_early_exit(int rows, int total, int skipped, long long lp_bound)
+{
+    std::cout << "Rows processed: " << rows << " of " << total << " (" << skipped
+              << " skipped by their bound, LP bound " << lp_bound << ")" << std::endl;
+}
+
+#endif // EARLY_EXIT_H
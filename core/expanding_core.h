@@ -0,0 +1,203 @@
+#ifndef EXPANDING_CORE_H
+#define EXPANDING_CORE_H
+
+#include <algorithm>
+#include <vector>
+#include "item.h"
+
+// Expanding-core solver in the style of Pisinger's minknap.
+//
+// With the items sorted by efficiency, greedy filling stops at the break
+// item b. Almost all of an optimal solution agrees with greedy away from b,
+// so the search starts from greedy (items before b in, the rest out) and
+// only decides a core [s, t] around b. Inside the core it keeps the
+// Pareto front of (weight, value) states. Adding item t+1 may take it,
+// adding item s-1 may drop it, and states may be overfull in between.
+//
+// A state's bound uses the efficiencies just outside the core. Items left
+// of s are at least as efficient as e(s-1) and items right of t at most
+// e(t+1), so no exchange can beat
+//
+//   value + (C - weight) e(t+1)     if weight <= C
+//   value - (weight - C) e(s-1)     if weight >  C
+//
+// States whose bound cannot beat the best feasible value are dropped. When
+// none are left, that value is optimal. The core only grows as far as the
+// instance needs: a few dozen items on correlated instances, where the
+// dense DP spends O(nC).
+struct CoreStats
+{
+    int core;          // items the core grew to
+    size_t largest;    // largest state front
+};
+
+struct CoreState
+{
+    long long weight;
+    long long value;
+};
+
+class ExpandingCore
+{
+    public:
+
+    ExpandingCore(const std::vector<Item> &input, int capacity) : capacity(capacity)
+    {
+        for (const Item &item : input)
+        {
+            if (item.value > 0 && item.weight > 0 && item.weight <= capacity)
+            {
+                items.push_back(item);
+            }
+        }
+
+        std::stable_sort(items.begin(), items.end(), [](const Item &a, const Item &b) {
+            return (long long)a.value * b.weight > (long long)b.value * a.weight;
+        });
+    }
+
+    long long solve(CoreStats &stats)
+    {
+        const int n = items.size();
+
+        // greedy up to the break item
+        long long weight = 0, value = 0;
+        int b = 0;
+        while (b < n && weight + items[b].weight <= capacity)
+        {
+            weight += items[b].weight;
+            value += items[b].value;
+            b++;
+        }
+
+        best = value;
+        front.assign(1, CoreState{weight, value});
+        stats.largest = 1;
+
+        // core is [s, t]; it starts empty just left of b
+        int s = b, t = b - 1;
+        bool right = true;
+
+        while (!front.empty() && (s > 0 || t < n - 1))
+        {
+            // grow alternately, or on the only side left
+            if ((right && t < n - 1) || s == 0)
+            {
+                t++;
+                merge(items[t].weight, items[t].value);
+            }
+            else
+            {
+                s--;
+                merge(-(long long)items[s].weight, -(long long)items[s].value);
+            }
+            right = !right;
+
+            prune(s, t);
+            stats.largest = std::max(stats.largest, front.size());
+        }
+
+        stats.core = t - s + 1;
+        return best;
+    }
+
+    private:
+
+    std::vector<Item> items;
+    int capacity;
+    long long best;
+    std::vector<CoreState> front, next;
+
+    // front := Pareto front of front and front + (dw, dv); both stay sorted
+    // by weight since the shift is the same for every state
+    void merge(long long dw, long long dv)
+    {
+        next.clear();
+        size_t a = 0, c = 0;
+        long long top = -1;
+        bool have = false;
+
+        while (a < front.size() || c < front.size())
+        {
+            CoreState s;
+            bool shifted = c < front.size() &&
+                           (a == front.size() || front[c].weight + dw < front[a].weight ||
+                            (front[c].weight + dw == front[a].weight && front[c].value + dv > front[a].value));
+            if (shifted)
+            {
+                s = CoreState{front[c].weight + dw, front[c].value + dv};
+                c++;
+            }
+            else
+            {
+                s = front[a++];
+            }
+
+            if (!have || s.value > top)
+            {
+                if (have && next.back().weight == s.weight)
+                {
+                    next.pop_back();
+                }
+                next.push_back(s);
+                top = s.value;
+                have = true;
+            }
+        }
+
+        front.swap(next);
+    }
+
+    // Record feasible states and drop every state that cannot beat `best`
+    void prune(int s, int t)
+    {
+        const int n = items.size();
+
+        for (const CoreState &state : front)
+        {
+            if (state.weight <= capacity)
+            {
+                best = std::max(best, state.value);
+            }
+        }
+
+        next.clear();
+        for (const CoreState &state : front)
+        {
+            long long bound;
+            if (state.weight <= capacity)
+            {
+                bound = state.value;
+                if (t + 1 < n)
+                {
+                    bound += (capacity - state.weight) * items[t + 1].value / items[t + 1].weight;
+                }
+            }
+            else
+            {
+                // overfull: only dropping items left of the core can fix it
+                if (s == 0)
+                {
+                    continue;
+                }
+                long long over = state.weight - capacity;
+                bound = state.value - (over * items[s - 1].value + items[s - 1].weight - 1) / items[s - 1].weight;
+            }
+
+            if (bound > best)
+            {
+                next.push_back(state);
+            }
+        }
+
+        front.swap(next);
+    }
+};
+
+inline int knapsack_expanding_core(const std::vector<Item> &items, int capacity, CoreStats &stats)
+{
+    ExpandingCore solver(items, capacity);
+    return solver.solve(stats) + weightless_value(items, capacity);
+}
+
+#endif // EXPANDING_CORE_H
@@ -0,0 +1,106 @@
+#ifndef FIXED_CAPACITY_H
+#define FIXED_CAPACITY_H
+
+#include <algorithm>
+#include <vector>
+#include "item.h"
+#include "kernel.h"
+
+// Small capacities with the row size known at compile time.
+//
+// knapsack_fixed<C> solves any capacity up to C on one row of C + 1 ints on
+// the stack (1 KB at 256, so it never leaves L1). Every loop runs to C, not
+// to the capacity, so its bound is a constant; the cells past the capacity
+// are padding and only cost a few extra lanes. Nothing is allocated,
+// timed or printed, which is most of what a call to the dp engine costs at
+// these sizes. The row update is the plain in-place loop, inlined into one
+// copy per ISA level (default, AVX2, AVX-512) so the compiler vectorizes it
+// for the kernel picked with --kernel; with rows this short that matches the
+// runtime kernels without their call and dispatch per row.
+//
+// knapsack_fixed_capacity() picks the power-of-two bucket that holds the
+// capacity, up to FIXED_CAPACITY_MAX.
+const int FIXED_CAPACITY_MAX = 256;
+
+template <int C>
+__attribute__((always_inline))
+inline int knapsack_fixed_rows(const std::vector<Item> &items, int capacity)
+{
+    alignas(64) int dp[C + 1];
+    std::fill(dp, dp + C + 1, 0);
+
+    for (const Item &item : items)
+    {
+        const int w = item.weight, v = item.value;
+        if (w > capacity || v <= 0 || is_weightless(item))
+        {
+            continue;
+        }
+
+        for (int j = C; j >= w; j--)
+        {
+            dp[j] = std::max(dp[j], dp[j - w] + v);
+        }
+    }
+
+    return dp[capacity] + weightless_value(items, capacity);
+}
+
+template <int C>
+inline int knapsack_fixed_scalar(const std::vector<Item> &items, int capacity)
+{
+    return knapsack_fixed_rows<C>(items, capacity);
+}
+
+template <int C>
+__attribute__((target("avx2")))
+inline int knapsack_fixed_avx2(const std::vector<Item> &items, int capacity)
+{
+    return knapsack_fixed_rows<C>(items, capacity);
+}
+
+template <int C>
+__attribute__((target("avx512f")))
+inline int knapsack_fixed_avx512(const std::vector<Item> &items, int capacity)
+{
+    return knapsack_fixed_rows<C>(items, capacity);
+}
+
+// Any capacity up to C, at the ISA level of the active kernel
+template <int C>
+inline int knapsack_fixed(const std::vector<Item> &items, int capacity)
+{
+    if (active_kernel.level == 2)
+    {
+        return knapsack_fixed_avx512<C>(items, capacity);
+    }
+    if (active_kernel.level == 1)
+    {
+        return knapsack_fixed_avx2<C>(items, capacity);
+    }
+    return knapsack_fixed_scalar<C>(items, capacity);
+}
+
+// Any capacity up to FIXED_CAPACITY_MAX
+inline int knapsack_fixed_capacity(const std::vector<Item> &items, int capacity)
+{
+    if (capacity <= 16)
+    {
+        return knapsack_fixed<16>(items, capacity);
+    }
+    if (capacity <= 32)
+    {
+        return knapsack_fixed<32>(items, capacity);
+    }
+    if (capacity <= 64)
+    {
+        return knapsack_fixed<64>(items, capacity);
+    }
+    if (capacity <= 128)
+    {
+        return knapsack_fixed<128>(items, capacity);
+    }
+    return knapsack_fixed<256>(items, capacity);
+}
+
+#endif // FIXED_CAPACITY_H
@@ -0,0 +1,113 @@
+#ifndef FPTAS_H
+#define FPTAS_H
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include "item.h"
+#include "value_dp.h"
+
+// (1 - epsilon) approximation by value scaling (Ibarra-Kim).
+//
+// Every value is divided by K = floor(epsilon * vmax / n) and rounded down,
+// and the value-indexed DP solves the scaled instance exactly. If it finds
+// scaled value B, some set is worth at least K B, and no set is worth more
+// than K (B + m), m being the most items that fit together. Since
+// K n <= epsilon vmax <= epsilon OPT, the answer K B is at least
+// (1 - epsilon) OPT. The value table shrinks by K, to at most n^2 / epsilon
+// columns, and to the LP bound over K when that is smaller.
+//
+// The certified bound is the smaller of K (B + m) and the Dantzig (LP)
+// bound of the unscaled items.
+struct Approximation
+{
+    std::vector<Item> items; // values divided by `scale`, weights kept
+    int scale;
+    long long weightless;    // value of items that weigh nothing, never scaled
+    long long max_items;     // most items that fit together
+    long long lp_bound;      // Dantzig bound of the items with weight
+};
+
+inline Approximation approximate_values(const std::vector<Item> &input, int capacity, double epsilon)
+{
+    Approximation a;
+    a.weightless = 0;
+
+    std::vector<Item> items;
+    int vmax = 0;
+    for (const Item &item : input)
+    {
+        if (item.value <= 0 || item.weight > capacity)
+        {
+            continue;
+        }
+
+        if (is_weightless(item))
+        {
+            a.weightless += item.value;
+            continue;
+        }
+
+        items.push_back(item);
+        vmax = std::max(vmax, item.value);
+    }
+
+    a.scale = items.empty() ? 1 : std::max(1.0, std::floor(epsilon * vmax / items.size()));
+    for (const Item &item : items)
+    {
+        a.items.push_back(Item(item.weight, item.value / a.scale));
+    }
+
+    // the lightest items first give the largest possible set
+    std::vector<int> weights;
+    for (const Item &item : items)
+    {
+        weights.push_back(item.weight);
+    }
+    std::sort(weights.begin(), weights.end());
+    long long room = capacity;
+    a.max_items = 0;
+    while (a.max_items < (long long)weights.size() && weights[a.max_items] <= room)
+    {
+        room -= weights[a.max_items++];
+    }
+
+    a.lp_bound = dantzig_bound(items, capacity);
+
+    return a;
+}
+
+// Value of a set the scaled DP found, from its best scaled value
+inline long long approximate_value(const Approximation &a, long long scaled, int capacity)
+{
+    return scaled * a.scale + weightless_gain(a.weightless, capacity);
+}
+
+// No set is worth more than this
+inline long long certified_bound(const Approximation &a, long long scaled, int capacity)
+{
+    long long bound = std::min((scaled + a.max_items) * a.scale, a.lp_bound);
+    return bound + weightless_gain(a.weightless, capacity);
+}
+
+inline void print_approximation(const Approximation &a, double epsilon, long long scaled, int capacity)
+{
+    long long value = approximate_value(a, scaled, capacity);
+    long long bound = certified_bound(a, scaled, capacity);
+    std::cout << "Approximation: epsilon " << epsilon << ", values scaled down by " << a.scale << std::endl;
+    std::cout << "Certified bound: optimum <= " << bound;
+    if (bound > 0)
+    {
+        std::cout << " (answer within " << 100.0 * (bound - value) / bound << "%)";
+    }
+    std::cout << std::endl;
+}
+
+// Scaled value the value-indexed DP reaches on the approximated instance
+inline long long knapsack_scaled(const Approximation &a, int capacity)
+{
+    return knapsack_by_value(a.items, capacity);
+}
+
+#endif // FPTAS_H
@@ -1,7 +1,54 @@
+#ifndef ITEM_H
+#define ITEM_H
+
+#include <vector>
+
 struct Item 
 {
     int weight;
     int value;
     Item(int w, int v) : weight(w), value(v) {}
     Item() : weight(), value() {}
-};
\ No newline at end of file
+};
+
+// Items that weigh nothing fit whenever anything does. Every engine leaves
+// them out of its rows or search and adds their value on top, for every
+// capacity of at least 1; at capacity 0 the answer is 0.
+inline bool is_weightless(const Item &item)
+{
+    return item.weight <= 0;
+}
+
+// What weightless items worth `value` together add to the answer at `capacity`
+inline long long weightless_gain(long long value, int capacity)
+{
+    return capacity >= 1 ? value : 0;
+}
+
+// What the weightless items of `items` add to the answer at `capacity`
+inline long long weightless_value(const std::vector<Item> &items, int capacity)
+{
+    long long value = 0;
+    for (const Item &item : items)
+    {
+        if (is_weightless(item) && item.value > 0)
+        {
+            value += item.value;
+        }
+    }
+    return weightless_gain(value, capacity);
+}
+
+// Appends the weightless items an optimal set takes at `capacity` to `chosen`
+inline void add_weightless(const std::vector<Item> &items, int capacity, std::vector<int> &chosen)
+{
+    for (int i = 0; i < (int)items.size(); i++)
+    {
+        if (is_weightless(items[i]) && weightless_gain(items[i].value, capacity) > 0)
+        {
+            chosen.push_back(i);
+        }
+    }
+}
+
+#endif // ITEM_H
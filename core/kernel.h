@@ -0,0 +1,472 @@
+#ifndef KERNEL_H
+#define KERNEL_H
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <stdint.h>
+#include <immintrin.h>
+
+// Row update kernels for the 0/1 knapsack recurrence over columns [lo, hi]:
+//
+//   cur[j] = max(prev[j], prev[j - weight] + value)    if weight <= j
+//   cur[j] = prev[j]                                   otherwise
+//
+// The item is loaded once per row instead of once per cell and the max is
+// branch free. The SIMD variants handle 8 (SSE4.2, two vectors), 8 (AVX2) or
+// 16 (AVX-512) columns per iteration and finish the row with the scalar loop. Each one is
+// compiled for its own ISA level through a target attribute, so a baseline
+// x86-64 binary carries all of them and picks one from cpuid at startup. An
+// empty range (lo > hi) is a no-op.
+
+// The in-place variants run the same recurrence on a single row, walking j
+// downward so dp[j - weight] still holds the previous item's value when it is
+// read. Columns below the weight are left untouched instead of being copied.
+// A vector block is only safe when the weight spans the whole block, so
+// lighter items take the scalar loop.
+
+// The unbounded variants allow any number of copies of the item:
+//
+//   cur[j] = max(prev[j], cur[j - weight] + value)
+//
+// walking j upward so cur[j - weight] already includes this item. With
+// prev == cur this is the usual forward in-place sweep. A vector block only
+// reads finished columns when the weight spans the whole block. There is no
+// decision-bit version; the weight must be positive.
+
+// With Bits set, every kernel also ORs a decision bit per column into a packed
+// row (bit j set when taking the item is strictly better at capacity j). The
+// SIMD variants get the bits straight from the compare mask, running a few
+// scalar columns first so the vector blocks line up with whole mask bytes. The
+// row must be zeroed beforehand and no other thread may write the same 64-bit
+// words.
+
+typedef void (*RowKernel)(const int* prev, int* cur, int lo, int hi, int weight, int value, uint64_t* bits);
+typedef void (*RowKernelInPlace)(int* dp, int lo, int hi, int weight, int value, uint64_t* bits);
+
+// Store the compare mask of a vector block. Blocks with Bits set start on a
+// multiple of their width, so each one owns whole bytes of the decision row
+// and a plain store replaces a read-modify-write of the 64-bit word.
+template <typename Mask>
+inline void store_decision_mask(uint64_t* bits, int j, Mask mask)
+{
+    std::memcpy((char*)bits + (j >> 3), &mask, sizeof(Mask));
+}
+
+template <bool Bits>
+inline void row_update_scalar(const int* prev, int* cur, int lo, int hi, int weight, int value, uint64_t* bits)
+{
+    int j = lo;
+    const int split = std::max(lo, std::min(hi + 1, weight));
+
+    // columns the item does not fit in are a plain copy
+    for (; j < split; j++)
+    {
+        cur[j] = prev[j];
+    }
+
+    for (; j <= hi; j++)
+    {
+        const int take = prev[j - weight] + value;
+        cur[j] = prev[j] < take ? take : prev[j];
+        if (Bits)
+        {
+            bits[j >> 6] |= (uint64_t)(prev[j] < take) << (j & 63);
+        }
+    }
+}
+
+template <bool Bits>
+inline void row_update_inplace_scalar(int* dp, int lo, int hi, int weight, int value, uint64_t* bits)
+{
+    const int stop = std::max(lo, weight);
+
+    for (int j = hi; j >= stop; j--)
+    {
+        const int take = dp[j - weight] + value;
+        if (Bits)
+        {
+            bits[j >> 6] |= (uint64_t)(dp[j] < take) << (j & 63);
+        }
+        dp[j] = dp[j] < take ? take : dp[j];
+    }
+}
+
+template <bool Bits>
+__attribute__((target("sse4.2")))
+inline void row_update_sse42(const int* prev, int* cur, int lo, int hi, int weight, int value, uint64_t* bits)
+{
+    int j = lo;
+    const int split = std::max(lo, std::min(hi + 1, weight));
+    std::copy(prev + j, prev + split, cur + j);
+    j = split;
+
+    if (Bits)
+    {
+        const int aligned = std::min(hi + 1, (j + 7) & ~7);
+        row_update_scalar<Bits>(prev, cur, j, aligned - 1, weight, value, bits);
+        j = aligned;
+    }
+
+    const __m128i v = _mm_set1_epi32(value);
+    for (; j + 7 <= hi; j += 8)
+    {
+        const __m128i skip0 = _mm_loadu_si128((const __m128i*)(prev + j));
+        const __m128i take0 = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(prev + j - weight)), v);
+        _mm_storeu_si128((__m128i*)(cur + j), _mm_max_epi32(skip0, take0));
+        const __m128i skip1 = _mm_loadu_si128((const __m128i*)(prev + j + 4));
+        const __m128i take1 = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(prev + j + 4 - weight)), v);
+        _mm_storeu_si128((__m128i*)(cur + j + 4), _mm_max_epi32(skip1, take1));
+        if (Bits)
+        {
+            const int low = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(take0, skip0)));
+            const int high = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(take1, skip1)));
+            store_decision_mask(bits, j, (uint8_t)(low | (high << 4)));
+        }
+    }
+
+    row_update_scalar<Bits>(prev, cur, j, hi, weight, value, bits);
+}
+
+template <bool Bits>
+__attribute__((target("sse4.2")))
+inline void row_update_inplace_sse42(int* dp, int lo, int hi, int weight, int value, uint64_t* bits)
+{
+    const int stop = std::max(lo, weight);
+    int j = hi;
+
+    if (weight >= 8)
+    {
+        if (Bits)
+        {
+            const int aligned = std::max(stop, (hi + 1) & ~7);
+            row_update_inplace_scalar<Bits>(dp, aligned, hi, weight, value, bits);
+            j = aligned - 1;
+        }
+
+        const __m128i v = _mm_set1_epi32(value);
+        for (; j - 7 >= stop; j -= 8)
+        {
+            const __m128i skip0 = _mm_loadu_si128((const __m128i*)(dp + j - 7));
+            const __m128i take0 = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(dp + j - 7 - weight)), v);
+            _mm_storeu_si128((__m128i*)(dp + j - 7), _mm_max_epi32(skip0, take0));
+            const __m128i skip1 = _mm_loadu_si128((const __m128i*)(dp + j - 3));
+            const __m128i take1 = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(dp + j - 3 - weight)), v);
+            _mm_storeu_si128((__m128i*)(dp + j - 3), _mm_max_epi32(skip1, take1));
+            if (Bits)
+            {
+                const int low = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(take0, skip0)));
+                const int high = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(take1, skip1)));
+                store_decision_mask(bits, j - 7, (uint8_t)(low | (high << 4)));
+            }
+        }
+    }
+
+    row_update_inplace_scalar<Bits>(dp, lo, j, weight, value, bits);
+}
+
+template <bool Bits>
+__attribute__((target("avx2")))
+inline void row_update_avx2(const int* prev, int* cur, int lo, int hi, int weight, int value, uint64_t* bits)
+{
+    int j = lo;
+    const int split = std::max(lo, std::min(hi + 1, weight));
+    std::copy(prev + j, prev + split, cur + j);
+    j = split;
+
+    if (Bits)
+    {
+        const int aligned = std::min(hi + 1, (j + 7) & ~7);
+        row_update_scalar<Bits>(prev, cur, j, aligned - 1, weight, value, bits);
+        j = aligned;
+    }
+
+    const __m256i v = _mm256_set1_epi32(value);
+    for (; j + 7 <= hi; j += 8)
+    {
+        const __m256i skip = _mm256_loadu_si256((const __m256i*)(prev + j));
+        const __m256i take = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(prev + j - weight)), v);
+        _mm256_storeu_si256((__m256i*)(cur + j), _mm256_max_epi32(skip, take));
+        if (Bits)
+        {
+            store_decision_mask(bits, j, (uint8_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(take, skip))));
+        }
+    }
+
+    row_update_scalar<Bits>(prev, cur, j, hi, weight, value, bits);
+}
+
+template <bool Bits>
+__attribute__((target("avx2")))
+inline void row_update_inplace_avx2(int* dp, int lo, int hi, int weight, int value, uint64_t* bits)
+{
+    const int stop = std::max(lo, weight);
+    int j = hi;
+
+    if (weight >= 8)
+    {
+        if (Bits)
+        {
+            const int aligned = std::max(stop, (hi + 1) & ~7);
+            row_update_inplace_scalar<Bits>(dp, aligned, hi, weight, value, bits);
+            j = aligned - 1;
+        }
+
+        const __m256i v = _mm256_set1_epi32(value);
+        for (; j - 7 >= stop; j -= 8)
+        {
+            const __m256i skip = _mm256_loadu_si256((const __m256i*)(dp + j - 7));
+            const __m256i take = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(dp + j - 7 - weight)), v);
+            _mm256_storeu_si256((__m256i*)(dp + j - 7), _mm256_max_epi32(skip, take));
+            if (Bits)
+            {
+                store_decision_mask(bits, j - 7, (uint8_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(take, skip))));
+            }
+        }
+    }
+
+    row_update_inplace_scalar<Bits>(dp, lo, j, weight, value, bits);
+}
+
+template <bool Bits>
+__attribute__((target("avx512f")))
+inline void row_update_avx512(const int* prev, int* cur, int lo, int hi, int weight, int value, uint64_t* bits)
+{
+    int j = lo;
+    const int split = std::max(lo, std::min(hi + 1, weight));
+    std::copy(prev + j, prev + split, cur + j);
+    j = split;
+
+    if (Bits)
+    {
+        const int aligned = std::min(hi + 1, (j + 15) & ~15);
+        row_update_scalar<Bits>(prev, cur, j, aligned - 1, weight, value, bits);
+        j = aligned;
+    }
+
+    const __m512i v = _mm512_set1_epi32(value);
+    for (; j + 15 <= hi; j += 16)
+    {
+        const __m512i skip = _mm512_loadu_si512((const void*)(prev + j));
+        const __m512i take = _mm512_add_epi32(_mm512_loadu_si512((const void*)(prev + j - weight)), v);
+        _mm512_storeu_si512((void*)(cur + j), _mm512_max_epi32(skip, take));
+        if (Bits)
+        {
+            store_decision_mask(bits, j, (uint16_t)_mm512_cmpgt_epi32_mask(take, skip));
+        }
+    }
+
+    row_update_scalar<Bits>(prev, cur, j, hi, weight, value, bits);
+}
+
+template <bool Bits>
+__attribute__((target("avx512f")))
+inline void row_update_inplace_avx512(int* dp, int lo, int hi, int weight, int value, uint64_t* bits)
+{
+    const int stop = std::max(lo, weight);
+    int j = hi;
+
+    if (weight >= 16)
+    {
+        if (Bits)
+        {
+            const int aligned = std::max(stop, (hi + 1) & ~15);
+            row_update_inplace_scalar<Bits>(dp, aligned, hi, weight, value, bits);
+            j = aligned - 1;
+        }
+
+        const __m512i v = _mm512_set1_epi32(value);
+        for (; j - 15 >= stop; j -= 16)
+        {
+            const __m512i skip = _mm512_loadu_si512((const void*)(dp + j - 15));
+            const __m512i take = _mm512_add_epi32(_mm512_loadu_si512((const void*)(dp + j - 15 - weight)), v);
+            _mm512_storeu_si512((void*)(dp + j - 15), _mm512_max_epi32(skip, take));
+            if (Bits)
+            {
+                store_decision_mask(bits, j - 15, (uint16_t)_mm512_cmpgt_epi32_mask(take, skip));
+            }
+        }
+    }
+
+    row_update_inplace_scalar<Bits>(dp, lo, j, weight, value, bits);
+}
+
+inline void row_update_unbounded_scalar(const int* prev, int* cur, int lo, int hi, int weight, int value, uint64_t*)
+{
+    int j = lo;
+    const int split = std::max(lo, std::min(hi + 1, weight));
+    if (prev != cur)
+    {
+        std::copy(prev + j, prev + split, cur + j);
+    }
+
+    for (j = split; j <= hi; j++)
+    {
+        const int take = cur[j - weight] + value;
+        cur[j] = prev[j] < take ? take : prev[j];
+    }
+}
+
+__attribute__((target("sse4.2")))
+inline void row_update_unbounded_sse42(const int* prev, int* cur, int lo, int hi, int weight, int value, uint64_t* bits)
+{
+    int j = lo;
+    const int split = std::max(lo, std::min(hi + 1, weight));
+    if (prev != cur)
+    {
+        std::copy(prev + j, prev + split, cur + j);
+    }
+    j = split;
+
+    if (weight >= 8)
+    {
+        const __m128i v = _mm_set1_epi32(value);
+        for (; j + 7 <= hi; j += 8)
+        {
+            const __m128i take0 = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(cur + j - weight)), v);
+            const __m128i take1 = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(cur + j + 4 - weight)), v);
+            _mm_storeu_si128((__m128i*)(cur + j), _mm_max_epi32(_mm_loadu_si128((const __m128i*)(prev + j)), take0));
+            _mm_storeu_si128((__m128i*)(cur + j + 4), _mm_max_epi32(_mm_loadu_si128((const __m128i*)(prev + j + 4)), take1));
+        }
+    }
+
+    row_update_unbounded_scalar(prev, cur, j, hi, weight, value, bits);
+}
+
+__attribute__((target("avx2")))
+inline void row_update_unbounded_avx2(const int* prev, int* cur, int lo, int hi, int weight, int value, uint64_t* bits)
+{
+    int j = lo;
+    const int split = std::max(lo, std::min(hi + 1, weight));
+    if (prev != cur)
+    {
+        std::copy(prev + j, prev + split, cur + j);
+    }
+    j = split;
+
+    if (weight >= 8)
+    {
+        const __m256i v = _mm256_set1_epi32(value);
+        for (; j + 7 <= hi; j += 8)
+        {
+            const __m256i take = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(cur + j - weight)), v);
+            _mm256_storeu_si256((__m256i*)(cur + j), _mm256_max_epi32(_mm256_loadu_si256((const __m256i*)(prev + j)), take));
+        }
+    }
+
+    row_update_unbounded_scalar(prev, cur, j, hi, weight, value, bits);
+}
+
+__attribute__((target("avx512f")))
+inline void row_update_unbounded_avx512(const int* prev, int* cur, int lo, int hi, int weight, int value, uint64_t* bits)
+{
+    int j = lo;
+    const int split = std::max(lo, std::min(hi + 1, weight));
+    if (prev != cur)
+    {
+        std::copy(prev + j, prev + split, cur + j);
+    }
+    j = split;
+
+    if (weight >= 16)
+    {
+        const __m512i v = _mm512_set1_epi32(value);
+        for (; j + 15 <= hi; j += 16)
+        {
+            const __m512i take = _mm512_add_epi32(_mm512_loadu_si512((const void*)(cur + j - weight)), v);
+            _mm512_storeu_si512((void*)(cur + j), _mm512_max_epi32(_mm512_loadu_si512((const void*)(prev + j)), take));
+        }
+    }
+
+    row_update_unbounded_scalar(prev, cur, j, hi, weight, value, bits);
+}
+
+struct KernelInfo
+{
+    const char* name;
+    RowKernel row;
+    RowKernelInPlace row_inplace;
+    RowKernel row_bits;
+    RowKernelInPlace row_inplace_bits;
+    RowKernel row_unbounded;
+    int level;     // for kernels kept next to their engines: 0 scalar, 1 AVX2, 2 AVX-512
+    int level_bw;  // the same for 16-bit lanes, 1 where AVX-512 lacks BW
+};
+
+#define KERNEL_ENTRY(name, isa, level) \
+    {name, row_update_##isa<false>, row_update_inplace_##isa<false>, row_update_##isa<true>, row_update_inplace_##isa<true>, \
+     row_update_unbounded_##isa, level, level}
+
+// Ordered from widest to narrowest so the first supported entry is the best one
+static const KernelInfo kernels[] = {
+    KERNEL_ENTRY("avx512", avx512, 2),
+    KERNEL_ENTRY("avx2", avx2, 1),
+    KERNEL_ENTRY("sse4.2", sse42, 0),
+    KERNEL_ENTRY("scalar", scalar, 0),
+};
+
+static KernelInfo active_kernel = KERNEL_ENTRY("scalar", scalar, 0);
+
+#undef KERNEL_ENTRY
+
+inline bool kernel_supported(const std::string& name)
+{
+    __builtin_cpu_init();
+
+    if (name == "avx512") return __builtin_cpu_supports("avx512f");
+    if (name == "avx2") return __builtin_cpu_supports("avx2");
+    if (name == "sse4.2") return __builtin_cpu_supports("sse4.2");
+    return name == "scalar";
+}
+
+// Pick the row kernel once at startup. "auto" takes the widest kernel the CPU
+// supports; anything else must name a kernel the CPU can run. Returns false if
+// the request cannot be honoured, leaving the current kernel in place.
+inline bool select_kernel(const std::string& name)
+{
+    for (const KernelInfo& k : kernels)
+    {
+        if ((name == "auto" || name == k.name) && kernel_supported(k.name))
+        {
+            active_kernel = k;
+            if (k.level == 2 && !__builtin_cpu_supports("avx512bw"))
+            {
+                active_kernel.level_bw = 1;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void row_update(const int* prev, int* cur, int lo, int hi, int weight, int value)
+{
+    active_kernel.row(prev, cur, lo, hi, weight, value, nullptr);
+}
+
+inline void row_update_inplace(int* dp, int lo, int hi, int weight, int value)
+{
+    active_kernel.row_inplace(dp, lo, hi, weight, value, nullptr);
+}
+
+inline void row_update_bits(const int* prev, int* cur, int lo, int hi, int weight, int value, uint64_t* bits)
+{
+    active_kernel.row_bits(prev, cur, lo, hi, weight, value, bits);
+}
+
+inline void row_update_inplace_bits(int* dp, int lo, int hi, int weight, int value, uint64_t* bits)
+{
+    active_kernel.row_inplace_bits(dp, lo, hi, weight, value, bits);
+}
+
+inline void row_update_unbounded(const int* prev, int* cur, int lo, int hi, int weight, int value)
+{
+    active_kernel.row_unbounded(prev, cur, lo, hi, weight, value, nullptr);
+}
+
+inline void row_update_unbounded_inplace(int* dp, int lo, int hi, int weight, int value)
+{
+    active_kernel.row_unbounded(dp, dp, lo, hi, weight, value, nullptr);
+}
+
+#endif // KERNEL_H
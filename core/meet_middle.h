@@ -0,0 +1,194 @@
+#ifndef MEET_MIDDLE_H
+#define MEET_MIDDLE_H
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "item.h"
+#include "pareto.h"
+
+// Meet in the middle, for few items and capacities far too large to index.
+//
+// Horowitz-Sahni splits the items in two halves and lists every subset of
+// each, keeping only the Pareto-optimal (weight, value) sums. A list comes
+// out sorted by weight with rising values, so the best partner of a left sum
+// is the heaviest right sum that still fits, and one two-pointer sweep
+// answers the instance. The halves are listed on two threads. Each list has
+// at most 2^(n/2) sums.
+//
+// Schroeppel-Shamir splits into quarters and never builds the half lists.
+// The left sums come out heaviest first from a max-heap over pairs of the
+// first two quarters' lists, and the right sums lightest first from a
+// min-heap over the last two. As the left sum gets lighter, more right sums
+// fit, so a running maximum of the right values is its best partner. Memory
+// is O(2^(n/4)) for the same O(2^(n/2) log) time.
+struct MeetStats
+{
+    size_t left;      // left sums listed (Schroeppel-Shamir: popped)
+    size_t right;     // right sums listed (Schroeppel-Shamir: popped)
+};
+
+// Pareto-optimal subset sums of items [first, last), lightest first
+inline std::vector<ParetoState> subset_sums(const std::vector<Item> &items, size_t first, size_t last, int capacity)
+{
+    std::vector<ParetoState> front(1, ParetoState{0, 0});
+    std::vector<ParetoState> next;
+    for (size_t i = first; i < last; i++)
+    {
+        pareto_merge(front, next, capacity, items[i].weight, items[i].value);
+        front.swap(next);
+    }
+    return front;
+}
+
+// Items that can matter, leaving out the weightless ones
+inline std::vector<Item> meet_items(const std::vector<Item> &input, int capacity)
+{
+    std::vector<Item> items;
+    for (const Item &item : input)
+    {
+        if (item.value <= 0 || item.weight > capacity || is_weightless(item))
+        {
+            continue;
+        }
+        items.push_back(item);
+    }
+    return items;
+}
+
+inline int knapsack_horowitz_sahni(const std::vector<Item> &input, int capacity, MeetStats &stats)
+{
+    std::vector<Item> items = meet_items(input, capacity);
+    const size_t half = items.size() / 2;
+
+    std::vector<ParetoState> left, right;
+    std::thread lister([&]() { right = subset_sums(items, half, items.size(), capacity); });
+    left = subset_sums(items, 0, half, capacity);
+    lister.join();
+
+    // lighter left sums leave room for heavier right ones
+    long long best = 0;
+    size_t r = right.size();
+    for (const ParetoState &a : left)
+    {
+        while (r > 0 && a.weight + right[r - 1].weight > capacity)
+        {
+            r--;
+        }
+        if (r == 0)
+        {
+            break;
+        }
+        best = std::max(best, a.value + right[r - 1].value);
+    }
+
+    stats.left = left.size();
+    stats.right = right.size();
+    return best + weightless_value(input, capacity);
+}
+
+// Sums of one list pair in weight order, from a heap of one cursor per
+// entry of the first list
+class SumStream
+{
+    public:
+
+    SumStream(std::vector<ParetoState> first, std::vector<ParetoState> second, bool heaviest_first)
+        : a(std::move(first)), b(std::move(second)), descending(heaviest_first)
+    {
+        for (size_t i = 0; i < a.size() && !b.empty(); i++)
+        {
+            push(i, descending ? b.size() - 1 : 0);
+        }
+    }
+
+    bool empty() const
+    {
+        return heap.empty();
+    }
+
+    ParetoState top() const
+    {
+        const Cursor &c = heap.top();
+        return ParetoState{c.weight, a[c.i].value + b[c.j].value};
+    }
+
+    void pop()
+    {
+        Cursor c = heap.top();
+        heap.pop();
+        if (descending && c.j > 0)
+        {
+            push(c.i, c.j - 1);
+        }
+        else if (!descending && c.j + 1 < b.size())
+        {
+            push(c.i, c.j + 1);
+        }
+    }
+
+    private:
+
+    struct Cursor
+    {
+        long long weight;
+        size_t i;
+        size_t j;
+    };
+
+    struct Later
+    {
+        bool descending;
+        bool operator()(const Cursor &x, const Cursor &y) const
+        {
+            return descending ? x.weight < y.weight : x.weight > y.weight;
+        }
+    };
+
+    std::vector<ParetoState> a, b;
+    bool descending;
+    std::priority_queue<Cursor, std::vector<Cursor>, Later> heap{Later{descending}};
+
+    void push(size_t i, size_t j)
+    {
+        heap.push(Cursor{a[i].weight + b[j].weight, i, j});
+    }
+};
+
+inline int knapsack_schroeppel_shamir(const std::vector<Item> &input, int capacity, MeetStats &stats)
+{
+    std::vector<Item> items = meet_items(input, capacity);
+    const size_t n = items.size();
+    const size_t q1 = n / 4, q2 = n / 2, q3 = n / 2 + (n - n / 2) / 2;
+
+    SumStream left(subset_sums(items, 0, q1, capacity), subset_sums(items, q1, q2, capacity), true);
+    SumStream right(subset_sums(items, q2, q3, capacity), subset_sums(items, q3, n, capacity), false);
+    stats.left = stats.right = 0;
+
+    // as the left sum gets lighter, more right sums fit
+    long long best = 0, partner = -1;
+    for (; !left.empty(); left.pop(), stats.left++)
+    {
+        ParetoState a = left.top();
+        if (a.weight > capacity)
+        {
+            continue;
+        }
+        while (!right.empty() && a.weight + right.top().weight <= capacity)
+        {
+            partner = std::max(partner, right.top().value);
+            right.pop();
+            stats.right++;
+        }
+        if (partner >= 0)
+        {
+            best = std::max(best, a.value + partner);
+        }
+    }
+
+    return best + weightless_value(input, capacity);
+}
+
+#endif // MEET_MIDDLE_H
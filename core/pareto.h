@@ -0,0 +1,127 @@
+#ifndef PARETO_H
+#define PARETO_H
+
+#include <algorithm>
+#include <vector>
+#include "item.h"
+#include "kernel.h"
+
+// Sparse knapsack over Pareto-optimal states (Nemhauser-Ullmann).
+//
+// Instead of a value per capacity column, keep the states (weight, value)
+// that no other state beats with less weight and at least as much value,
+// sorted by weight with strictly rising values. Adding an item merges the
+// front with a copy of itself shifted by (w, v) in one two-pointer pass, so
+// time and memory follow the front size rather than the capacity. The
+// answer is the value of the last state.
+//
+// The front can grow to the full capacity range. Once it passes `cap`
+// states the engine writes it out as a dense row and finishes the remaining
+// items with the in-place row kernel.
+struct ParetoState
+{
+    long long weight;
+    long long value;
+};
+
+struct ParetoStats
+{
+    size_t largest_front;
+    int dense_from; // item the dense fallback started at, -1 if it never did
+};
+
+// Merge `front` with front + (w, v), dropping dominated states and states
+// heavier than the capacity
+inline void pareto_merge(const std::vector<ParetoState> &front, std::vector<ParetoState> &next,
+                         int capacity, int weight, int value)
+{
+    next.clear();
+    size_t a = 0, b = 0;
+    long long best = -1;
+
+    while (a < front.size() || b < front.size())
+    {
+        ParetoState s;
+        bool shifted_ok = b < front.size() && front[b].weight + weight <= capacity;
+        if (!shifted_ok && a == front.size())
+        {
+            break;
+        }
+
+        if (shifted_ok && (a == front.size() || front[b].weight + weight < front[a].weight ||
+                           (front[b].weight + weight == front[a].weight && front[b].value + value > front[a].value)))
+        {
+            s.weight = front[b].weight + weight;
+            s.value = front[b].value + value;
+            b++;
+        }
+        else
+        {
+            s = front[a++];
+            if (!shifted_ok)
+            {
+                b = front.size();
+            }
+        }
+
+        if (s.value > best)
+        {
+            // equal weight, more value: the earlier state is dominated
+            if (!next.empty() && next.back().weight == s.weight)
+            {
+                next.pop_back();
+            }
+            next.push_back(s);
+            best = s.value;
+        }
+    }
+}
+
+inline int knapsack_pareto(const std::vector<Item> &items, int capacity, size_t cap, ParetoStats &stats)
+{
+    std::vector<ParetoState> front(1, ParetoState{0, 0});
+    std::vector<ParetoState> next;
+    stats.largest_front = 1;
+    stats.dense_from = -1;
+
+    int n = items.size();
+    int i = 0;
+    for (; i < n && front.size() <= cap; i++)
+    {
+        if (items[i].value <= 0 || items[i].weight > capacity || is_weightless(items[i]))
+        {
+            continue;
+        }
+
+        pareto_merge(front, next, capacity, items[i].weight, items[i].value);
+        front.swap(next);
+        stats.largest_front = std::max(stats.largest_front, front.size());
+    }
+
+    if (i == n)
+    {
+        return front.back().value + weightless_value(items, capacity);
+    }
+
+    // dense fallback: dp[j] is the best state no heavier than j
+    stats.dense_from = i;
+    std::vector<int> dp(capacity + 1, 0);
+    for (size_t k = 0; k < front.size(); k++)
+    {
+        long long end = k + 1 < front.size() ? front[k + 1].weight : (long long)capacity + 1;
+        std::fill(dp.begin() + front[k].weight, dp.begin() + end, (int)front[k].value);
+    }
+
+    for (; i < n; i++)
+    {
+        if (is_weightless(items[i]))
+        {
+            continue;
+        }
+        row_update_inplace(dp.data(), 1, capacity, items[i].weight, items[i].value);
+    }
+
+    return dp[capacity] + weightless_value(items, capacity);
+}
+
+#endif // PARETO_H
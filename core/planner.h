@@ -0,0 +1,121 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+#include "item.h"
+#include "preprocess.h"
+#include "window.h"
+
+// Item ordering planner.
+//
+// The DP answer does not depend on the order the items are applied in, but
+// the work does once rows are narrowed to the capacity window: a row updates
+// the columns [max(lo_i, w_i), capacity], and lo_i only rises once the weight
+// left is below the capacity. The planner picks an order and applies it to
+// the reduction, keeping `index` in step.
+//
+// Orders: input, weight (heaviest first, so the light items come last and
+// the window closes early), efficiency (value / weight, best first) and auto,
+// which takes whichever of those needs the fewest cell updates. Ties keep the
+// earlier order and items that compare equal keep their input order, so a
+// plan is a pure function of the items.
+
+const std::vector<std::string> item_orders = {"input", "weight", "efficiency"};
+
+struct Plan
+{
+    std::string order;
+    long long estimated_cells; // cell updates the planned order needs
+    long long input_cells;     // ... and the input order
+};
+
+inline bool valid_item_order(const std::string &name)
+{
+    return name == "auto" || std::find(item_orders.begin(), item_orders.end(), name) != item_orders.end();
+}
+
+inline std::vector<int> item_order(const std::vector<Item> &items, const std::string &name)
+{
+    std::vector<int> order(items.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    if (name == "weight")
+    {
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return items[a].weight > items[b].weight;
+        });
+    }
+    else if (name == "efficiency")
+    {
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return (long long)items[a].value * items[b].weight > (long long)items[b].value * items[a].weight;
+        });
+    }
+
+    return order;
+}
+
+// Cell updates of a full DP over the items in this order
+inline long long estimate_cells(const std::vector<Item> &items, const std::vector<int> &order, int capacity, bool window)
+{
+    long long cells = 0;
+    long long remaining = 0;
+    for (int k = (int)order.size() - 1; k >= 0; k--)
+    {
+        const Item &item = items[order[k]];
+        int lo = window ? (int)std::max(1LL, capacity - remaining) : 1;
+        cells += row_cells(lo, capacity, item.weight);
+        remaining += std::max(0, item.weight);
+    }
+    return cells;
+}
+
+// Reorder r.items as `name` asks (or auto picks)
+inline Plan plan_items(Reduction &r, const std::string &name, bool window)
+{
+    Plan plan;
+    std::vector<int> order = item_order(r.items, "input");
+    plan.order = "input";
+    plan.input_cells = plan.estimated_cells = estimate_cells(r.items, order, r.capacity, window);
+
+    for (const std::string &candidate : item_orders)
+    {
+        if (candidate == "input" || (name != "auto" && candidate != name))
+        {
+            continue;
+        }
+
+        std::vector<int> o = item_order(r.items, candidate);
+        long long cells = estimate_cells(r.items, o, r.capacity, window);
+        if (name == candidate || cells < plan.estimated_cells)
+        {
+            plan.order = candidate;
+            plan.estimated_cells = cells;
+            order.swap(o);
+        }
+    }
+
+    std::vector<Item> items;
+    std::vector<int> index;
+    for (int i : order)
+    {
+        items.push_back(r.items[i]);
+        index.push_back(r.index[i]);
+    }
+    r.items.swap(items);
+    r.index.swap(index);
+
+    return plan;
+}
+
+inline void print_plan(const Plan &plan, double seconds)
+{
+    std::cout << "Item order: " << plan.order << ", estimated " << plan.estimated_cells << " cell updates ("
+              << plan.input_cells << " in input order), planned in " << seconds << " seconds" << std::endl;
+}
+
+#endif // PLANNER_H
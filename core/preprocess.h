@@ -0,0 +1,323 @@
+#ifndef PREPROCESS_H
+#define PREPROCESS_H
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <vector>
+#include "item.h"
+
+// Item preprocessing shared by every engine. An engine is handed the reduced
+// item list; `index` maps each of those items back to its position in the
+// input so reconstructed solutions can be reported in input terms.
+struct Reduction
+{
+    std::vector<Item> items;
+    std::vector<int> index;
+    int capacity;
+
+    int input_items;
+    int too_heavy;
+    int worthless;
+    int dominated;
+
+    // variable fixing: input positions of the items in every optimal
+    // solution, which the engines never see, and their weight and value
+    std::vector<int> fixed;
+    long long fixed_weight;
+    long long fixed_value;
+    int fixed_out;
+
+    // every weight and the capacity were divided by this
+    int weight_scale;
+};
+
+// Reduction that keeps every item
+inline Reduction identity_reduction(const std::vector<Item> &items, int capacity)
+{
+    Reduction r;
+    r.items = items;
+    r.index.resize(items.size());
+    std::iota(r.index.begin(), r.index.end(), 0);
+    r.capacity = capacity;
+    r.input_items = items.size();
+    r.too_heavy = r.worthless = r.dominated = 0;
+    r.fixed_weight = r.fixed_value = 0;
+    r.fixed_out = 0;
+    r.weight_scale = 1;
+    return r;
+}
+
+// Dominance and cardinality pruning.
+//
+// Items heavier than the capacity and items without value are dropped. The
+// rest are scanned by increasing weight (higher value first on ties); item j
+// is dominated if the items already kept that are no heavier and at least as
+// valuable weigh more than capacity - w_j in total. Any solution holding j
+// then misses one of them, and swapping it in for j loses nothing. For equal
+// weights this is the cardinality rule: at most floor(C / w) items of weight
+// w fit, so only the floor(C / w) most valuable are kept.
+//
+// Kept weights are summed per value rank in a Fenwick tree, so the scan is
+// O(n log n). The kept items stay in input order.
+inline Reduction prune_items(const std::vector<Item> &items, int capacity)
+{
+    Reduction r = identity_reduction(std::vector<Item>(), capacity);
+    r.input_items = items.size();
+
+    std::vector<int> order;
+    for (int i = 0; i < (int)items.size(); i++)
+    {
+        if (items[i].weight > capacity)
+        {
+            r.too_heavy++;
+        }
+        else if (items[i].value <= 0)
+        {
+            r.worthless++;
+        }
+        else
+        {
+            order.push_back(i);
+        }
+    }
+
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        if (items[a].weight != items[b].weight) return items[a].weight < items[b].weight;
+        if (items[a].value != items[b].value) return items[a].value > items[b].value;
+        return a < b;
+    });
+
+    // value ranks, highest value = rank 1, so a prefix sum covers "at least as valuable"
+    std::vector<int> values;
+    for (int i : order)
+    {
+        values.push_back(items[i].value);
+    }
+    std::sort(values.begin(), values.end(), std::greater<int>());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+
+    std::vector<long long> fenwick(values.size() + 1, 0);
+    std::vector<char> keep(items.size(), 0);
+
+    for (int i : order)
+    {
+        int rank = std::lower_bound(values.begin(), values.end(), items[i].value, std::greater<int>()) - values.begin() + 1;
+
+        long long dominators = 0;
+        for (int k = rank; k > 0; k -= k & -k)
+        {
+            dominators += fenwick[k];
+        }
+
+        if (dominators > capacity - items[i].weight)
+        {
+            r.dominated++;
+            continue;
+        }
+
+        keep[i] = 1;
+        for (int k = rank; k < (int)fenwick.size(); k += k & -k)
+        {
+            fenwick[k] += items[i].weight;
+        }
+    }
+
+    for (int i = 0; i < (int)items.size(); i++)
+    {
+        if (keep[i])
+        {
+            r.items.push_back(items[i]);
+            r.index.push_back(i);
+        }
+    }
+
+    return r;
+}
+
+inline void print_reduction(const Reduction &r, double seconds)
+{
+    std::cout << "Preprocessing: kept " << r.items.size() << " of " << r.input_items << " items ("
+              << r.too_heavy << " too heavy, " << r.worthless << " without value, "
+              << r.dominated << " dominated) in " << seconds << " seconds" << std::endl;
+}
+
+// Variable fixing (Ingargiola-Korsh, with Martello and Toth's bounds).
+//
+// With the items by efficiency and b the break item, the Dantzig bound of
+// the instance with item j forced out (j before b) or in (j from b on) is
+// one binary search over the weight prefix sums. Every such subproblem also
+// yields a feasible set, its greedy prefix, so the best of those and plain
+// greedy is a lower bound L. An item whose forced bound is below L is in
+// (j before b) or out (j from b on) of every optimal solution. Fixed-in
+// items leave the instance and their weight comes off the capacity, so the
+// engines only see the free items. On correlated instances almost every
+// item but a few around b gets fixed.
+//
+// Weightless items are fixed in wherever they add to the answer.
+inline Reduction fix_items(const Reduction &in)
+{
+    Reduction r = in;
+    r.items.clear();
+    r.index.clear();
+    const long long capacity = in.capacity;
+    const int n = in.items.size();
+
+    std::vector<int> order;
+    std::vector<char> state(n, 0); // 0 free, 1 fixed in, -1 fixed out
+    for (int i = 0; i < n; i++)
+    {
+        const Item &item = in.items[i];
+        if (is_weightless(item) && weightless_gain(item.value, capacity) > 0)
+        {
+            state[i] = 1;
+        }
+        else if (item.weight > 0 && item.weight <= capacity && item.value > 0)
+        {
+            order.push_back(i);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return (long long)in.items[a].value * in.items[b].weight > (long long)in.items[b].value * in.items[a].weight;
+    });
+
+    const int m = order.size();
+    std::vector<long long> W(m + 1, 0), V(m + 1, 0);
+    for (int k = 0; k < m; k++)
+    {
+        W[k + 1] = W[k] + in.items[order[k]].weight;
+        V[k + 1] = V[k] + in.items[order[k]].value;
+    }
+    // first item that does not fit in `room`: the prefix [0, t) does
+    auto split = [&](long long room) {
+        return int(std::upper_bound(W.begin(), W.end(), room) - W.begin()) - 1;
+    };
+    auto fraction = [&](int t, long long room) -> long long {
+        return t < m ? room * in.items[order[t]].value / in.items[order[t]].weight : 0;
+    };
+    const int b = split(capacity);
+
+    // lower bound: greedy over every item, then the subproblems' prefixes
+    long long lower = 0, room = capacity;
+    for (int k = 0; k < m; k++)
+    {
+        if (in.items[order[k]].weight <= room)
+        {
+            room -= in.items[order[k]].weight;
+            lower += in.items[order[k]].value;
+        }
+    }
+
+    // forced bound of item k, and the value of that subproblem's prefix
+    std::vector<long long> upper(m);
+    for (int k = 0; k < m && b < m; k++)
+    {
+        const Item &item = in.items[order[k]];
+        long long feasible;
+        if (k < b)
+        {
+            // out: the prefix without k reaches further
+            int t = split(capacity + item.weight);
+            feasible = V[t] - item.value;
+            upper[k] = feasible + fraction(t, capacity + item.weight - W[t]);
+        }
+        else
+        {
+            // in: the prefix fills what k leaves, and stops before k
+            int t = split(capacity - item.weight);
+            feasible = V[t] + item.value;
+            upper[k] = feasible + fraction(t, capacity - item.weight - W[t]);
+        }
+        lower = std::max(lower, feasible);
+    }
+
+    for (int k = 0; k < m && b < m; k++)
+    {
+        if (upper[k] < lower)
+        {
+            state[order[k]] = k < b ? 1 : -1;
+        }
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        if (state[i] == 1)
+        {
+            r.fixed.push_back(in.index[i]);
+            r.fixed_weight += std::max(0, in.items[i].weight);
+            r.fixed_value += in.items[i].value;
+        }
+    }
+    r.capacity = in.capacity - r.fixed_weight;
+
+    // items that no longer fit next to the fixed ones are out as well
+    for (int i = 0; i < n; i++)
+    {
+        if (state[i] == 0 && in.items[i].weight <= r.capacity)
+        {
+            r.items.push_back(in.items[i]);
+            r.index.push_back(in.index[i]);
+        }
+        else if (state[i] != 1)
+        {
+            r.fixed_out++;
+        }
+    }
+
+    return r;
+}
+
+inline void print_fixing(const Reduction &r, double seconds)
+{
+    std::cout << "Variable fixing: " << r.fixed.size() << " items fixed in (weight " << r.fixed_weight
+              << ", value " << r.fixed_value << "), " << r.fixed_out << " fixed out, " << r.items.size()
+              << " free, capacity " << r.capacity << " in " << seconds << " seconds" << std::endl;
+}
+
+// Weight normalization: when all weights share a divisor g, dividing them
+// and the capacity (rounded down) by g changes no answer, and every engine
+// runs on C / g + 1 columns. Weights in grams that are all multiples of 5
+// or 10 are the common case. Nothing changes when C / g would be 0, which
+// would drop weightless items.
+inline Reduction normalize_weights(const Reduction &in)
+{
+    int g = 0;
+    for (const Item &item : in.items)
+    {
+        if (item.weight > 0 && item.weight <= in.capacity)
+        {
+            int a = item.weight;
+            while (a != 0)
+            {
+                int t = g % a;
+                g = a;
+                a = t;
+            }
+        }
+    }
+
+    Reduction r = in;
+    if (g <= 1 || in.capacity / g == 0)
+    {
+        return r;
+    }
+
+    // items that do not fit stay too heavy after rounding the capacity down
+    for (Item &item : r.items)
+    {
+        item.weight = item.weight > in.capacity ? in.capacity / g + 1 : item.weight / g;
+    }
+    r.capacity = in.capacity / g;
+    r.weight_scale = in.weight_scale * g;
+    return r;
+}
+
+inline void print_normalization(const Reduction &r)
+{
+    if (r.weight_scale > 1)
+    {
+        std::cout << "Weights scaled down by " << r.weight_scale << ", capacity " << r.capacity << std::endl;
+    }
+}
+
+#endif // PREPROCESS_H
@@ -0,0 +1,123 @@
+#ifndef RECONSTRUCT_H
+#define RECONSTRUCT_H
+
+#include <algorithm>
+#include <vector>
+#include "item.h"
+#include "kernel.h"
+
+// Optimal item-set reconstruction in O(capacity) memory (Hirschberg style).
+//
+// The items are split in half. One value row is computed for each half over
+// capacities 0..capacity; the optimum is the best F[c] + B[capacity - c], and
+// that c is how much capacity the first half gets in some optimal solution.
+// Both halves are then solved recursively with their share of the capacity.
+// Each level of the recursion costs at most one value-only solve, and the
+// capacity handed down shrinks, so the total is about twice the forward pass.
+// Subproblems small enough to fit RECONSTRUCT_BASE_CELLS are finished with a
+// full table and a plain backtrack instead of recursing down to single items.
+// Weightless items leave every row as it is and join the set at the end.
+
+#define RECONSTRUCT_BASE_CELLS (1 << 16)
+
+// Best value of items[lo, hi) for every capacity 0..capacity, written to row
+inline void reconstruct_row(const std::vector<Item> &items, int lo, int hi, int capacity, std::vector<int> &row)
+{
+    row.assign(capacity + 1, 0);
+
+    for (int i = lo; i < hi; i++)
+    {
+        if (!is_weightless(items[i]))
+        {
+            row_update_inplace(row.data(), 1, capacity, items[i].weight, items[i].value);
+        }
+    }
+}
+
+inline void reconstruct_range(const std::vector<Item> &items, int lo, int hi, int capacity, std::vector<int> &chosen)
+{
+    if (capacity == 0)
+    {
+        return;
+    }
+
+    // a single item is taken iff it fits and is worth something; splitting
+    // it would hand all of the capacity to the same item again
+    if (hi - lo == 1)
+    {
+        if (items[lo].weight <= capacity && items[lo].value > 0 && !is_weightless(items[lo]))
+        {
+            chosen.push_back(lo);
+        }
+        return;
+    }
+
+    if ((long)(hi - lo) * (capacity + 1) <= RECONSTRUCT_BASE_CELLS)
+    {
+        // full table for the small subproblem, row k holds items[lo, lo + k)
+        std::vector<int> table((hi - lo + 1) * (capacity + 1), 0);
+        for (int i = lo; i < hi; i++)
+        {
+            int k = i - lo;
+            if (is_weightless(items[i]))
+            {
+                std::copy(&table[k * (capacity + 1)], &table[(k + 1) * (capacity + 1)], &table[(k + 1) * (capacity + 1)]);
+                continue;
+            }
+            row_update(&table[k * (capacity + 1)], &table[(k + 1) * (capacity + 1)], 1, capacity,
+                       items[i].weight, items[i].value);
+        }
+
+        int c = capacity;
+        for (int i = hi - 1; i >= lo; i--)
+        {
+            int k = i - lo;
+            if (table[(k + 1) * (capacity + 1) + c] != table[k * (capacity + 1) + c])
+            {
+                chosen.push_back(i);
+                c -= items[i].weight;
+            }
+        }
+        return;
+    }
+
+    int mid = lo + (hi - lo) / 2;
+    int split = 0;
+
+    // rows are released before recursing so only one level holds memory at a time
+    {
+        std::vector<int> forward, backward;
+        reconstruct_row(items, lo, mid, capacity, forward);
+        reconstruct_row(items, mid, hi, capacity, backward);
+
+        int best = -1;
+        for (int c = 0; c <= capacity; c++)
+        {
+            if (forward[c] + backward[capacity - c] > best)
+            {
+                best = forward[c] + backward[capacity - c];
+                split = c;
+            }
+        }
+    }
+
+    reconstruct_range(items, lo, mid, split, chosen);
+    reconstruct_range(items, mid, hi, capacity - split, chosen);
+}
+
+// Indices (ascending) of an optimal set of items
+inline std::vector<int> knapsack_reconstruct(const std::vector<Item> &items, int capacity)
+{
+    std::vector<int> chosen;
+
+    if (!items.empty())
+    {
+        reconstruct_range(items, 0, items.size(), capacity, chosen);
+    }
+    add_weightless(items, capacity, chosen);
+
+    std::sort(chosen.begin(), chosen.end());
+    return chosen;
+}
+
+#endif // RECONSTRUCT_H
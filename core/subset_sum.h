@@ -0,0 +1,214 @@
+#ifndef SUBSET_SUM_H
+#define SUBSET_SUM_H
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include <immintrin.h>
+#include "item.h"
+#include "kernel.h"
+
+// Bit-parallel subset sum.
+//
+// When every item's value equals its weight, the best value is the largest
+// reachable weight up to C. The same holds, times c, when every value is c
+// times its weight, which is what subset sum looks like once the weights
+// were divided by their gcd. Reachability needs one bit per capacity, and an
+// item is
+//
+//   reach |= reach << w
+//
+// over 64-bit words, 64 capacities per word operation instead of one per
+// int cell (and 32 times less memory). A word only reads lower words, so the
+// in-place sweep runs from the top down. The AVX2 sweep does four words per
+// step and follows the kernel picked with --kernel. The threaded sweep splits
+// the words between threads, and double buffers with a barrier per item
+// because a thread's words read those of the threads below it.
+
+// c when every value is c times its weight, 0 otherwise. Items without
+// weight or value do not count.
+inline long long subset_sum_ratio(const std::vector<Item> &items)
+{
+    long long ratio = 0;
+    for (const Item &item : items)
+    {
+        if (item.weight <= 0 || item.value <= 0)
+        {
+            continue;
+        }
+        if (item.value % item.weight != 0 || (ratio != 0 && item.value / item.weight != ratio))
+        {
+            return 0;
+        }
+        ratio = item.value / item.weight;
+    }
+    return ratio;
+}
+
+// next[k] |= (cur << shift)[k] for words k in [lo, hi]; next may be cur
+// when the words are walked downward
+inline void shift_or_scalar(const uint64_t *cur, uint64_t *next, long long lo, long long hi, long long shift)
+{
+    const long long q = shift >> 6;
+    const int r = shift & 63;
+    for (long long k = hi; k >= std::max(lo, q); k--)
+    {
+        uint64_t moved = cur[k - q] << r;
+        if (r != 0 && k - q - 1 >= 0)
+        {
+            moved |= cur[k - q - 1] >> (64 - r);
+        }
+        next[k] = cur[k] | moved;
+    }
+}
+
+__attribute__((target("avx2")))
+inline void shift_or_avx2(const uint64_t *cur, uint64_t *next, long long lo, long long hi, long long shift)
+{
+    const long long q = shift >> 6;
+    const int r = shift & 63;
+    const __m128i left = _mm_set_epi64x(0, r);
+    const __m128i right = _mm_set_epi64x(0, 64 - r); // 64 shifts everything out
+
+    // blocks [k - 3, k] whose lower neighbours k - q - 4 .. k - q - 1 exist
+    long long k = hi;
+    for (; k - 3 >= std::max(lo, q + 1); k -= 4)
+    {
+        const __m256i same = _mm256_loadu_si256((const __m256i *)(cur + k - 3 - q));
+        const __m256i below = _mm256_loadu_si256((const __m256i *)(cur + k - 4 - q));
+        const __m256i moved = _mm256_or_si256(_mm256_sll_epi64(same, left), _mm256_srl_epi64(below, right));
+        const __m256i old = _mm256_loadu_si256((const __m256i *)(cur + k - 3));
+        _mm256_storeu_si256((__m256i *)(next + k - 3), _mm256_or_si256(old, moved));
+    }
+
+    shift_or_scalar(cur, next, lo, k, shift);
+}
+
+inline void shift_or(const uint64_t *cur, uint64_t *next, long long lo, long long hi, long long shift)
+{
+    if (active_kernel.level >= 1)
+    {
+        shift_or_avx2(cur, next, lo, hi, shift);
+    }
+    else
+    {
+        shift_or_scalar(cur, next, lo, hi, shift);
+    }
+}
+
+// Largest set bit at or below `capacity`
+inline long long highest_reachable(const std::vector<uint64_t> &reach, int capacity)
+{
+    for (long long k = capacity >> 6; k >= 0; k--)
+    {
+        uint64_t word = reach[k];
+        if (k == capacity >> 6 && (capacity & 63) != 63)
+        {
+            word &= (uint64_t(1) << ((capacity & 63) + 1)) - 1;
+        }
+        if (word != 0)
+        {
+            return k * 64 + 63 - __builtin_clzll(word);
+        }
+    }
+    return 0;
+}
+
+// Weights of the items that can matter, leaving out the weightless ones
+inline std::vector<int> subset_weights(const std::vector<Item> &items, int capacity)
+{
+    std::vector<int> weights;
+    for (const Item &item : items)
+    {
+        if (item.value <= 0 || item.weight > capacity || is_weightless(item))
+        {
+            continue;
+        }
+        weights.push_back(item.weight);
+    }
+    return weights;
+}
+
+// Spinning barrier for the threads of one sweep
+class SweepBarrier
+{
+    public:
+
+    explicit SweepBarrier(int count) : count(count), waiting(0), generation(0) {}
+
+    void wait()
+    {
+        int gen = generation.load();
+        if (waiting.fetch_add(1) + 1 == count)
+        {
+            waiting.store(0);
+            generation.fetch_add(1);
+            return;
+        }
+        while (generation.load() == gen)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    private:
+
+    const int count;
+    std::atomic<int> waiting;
+    std::atomic<int> generation;
+};
+
+inline long long knapsack_subset_sum(const std::vector<Item> &items, int capacity, int nThreads)
+{
+    std::vector<int> weights = subset_weights(items, capacity);
+    const long long words = ((long long)capacity >> 6) + 1;
+
+    std::vector<uint64_t> reach(words, 0);
+    reach[0] = 1;
+
+    nThreads = std::max(1, std::min<int>(nThreads, words));
+    if (nThreads == 1)
+    {
+        for (int w : weights)
+        {
+            shift_or(reach.data(), reach.data(), 0, words - 1, w);
+        }
+    }
+    else
+    {
+        std::vector<uint64_t> other(reach);
+        SweepBarrier barrier(nThreads);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < nThreads; t++)
+        {
+            threads.push_back(std::thread([&, t]() {
+                const long long lo = words * t / nThreads, hi = words * (t + 1) / nThreads - 1;
+                uint64_t *cur = reach.data(), *next = other.data();
+                for (int w : weights)
+                {
+                    // words below the shift keep their bits
+                    std::copy(cur + lo, cur + std::min(hi + 1, std::max(lo, (long long)w >> 6)), next + lo);
+                    shift_or(cur, next, lo, hi, w);
+                    barrier.wait();
+                    std::swap(cur, next);
+                }
+            }));
+        }
+        for (std::thread &t : threads)
+        {
+            t.join();
+        }
+        if (weights.size() % 2 == 1)
+        {
+            reach.swap(other);
+        }
+    }
+
+    // any other values are taken to be the weights
+    long long ratio = std::max(1LL, subset_sum_ratio(items));
+    return highest_reachable(reach, capacity) * ratio + weightless_value(items, capacity);
+}
+
+#endif // SUBSET_SUM_H
@@ -0,0 +1,120 @@
+#ifndef TILED_H
+#define TILED_H
+
+#include <algorithm>
+#include <vector>
+#include "item.h"
+#include "kernel.h"
+
+// Temporally blocked DP for capacities larger than the cache.
+//
+// The plain engine streams the whole row through memory once per item. Here
+// a block of items is applied to one capacity tile at a time, low tiles
+// first, so the tile stays in cache for the whole block. An item of weight w
+// at column j reads column j - w of the previous row, which for the left edge
+// of a tile lies in the tile below. Those columns have already moved on to the
+// end of the block, so every tile saves a ghost strip of its top W columns
+// (W = heaviest item in the block) after each item, and the next tile starts
+// each item from that strip.
+//
+// Per block the row is read and written once, plus B * W ghost ints per tile,
+// instead of B full passes over the row. That only pays off while W is small
+// next to the tile, so items heavier than half a tile get an ordinary
+// full-row sweep instead (the answer does not depend on item order).
+
+struct TiledStats
+{
+    long long cells;
+    double bytes;
+    double naive_bytes;
+};
+
+inline int knapsack_tiled_solve(const std::vector<Item> &items, int capacity, int tile, int block, TiledStats &stats)
+{
+    std::vector<int> dp(capacity + 1, 0);
+
+    stats.cells = 0;
+    stats.bytes = 0;
+    stats.naive_bytes = 0;
+
+    std::vector<Item> light;
+    for (const Item& item : items)
+    {
+        // items that can never fit do not change the row; weightless ones
+        // are added at the end
+        if (item.weight > capacity || is_weightless(item))
+        {
+            continue;
+        }
+
+        if (2 * item.weight > tile)
+        {
+            row_update_inplace(dp.data(), 1, capacity, item.weight, item.value);
+            stats.cells += capacity - std::max(1, item.weight) + 1;
+            stats.bytes += 2.0 * (capacity + 1) * sizeof(int);
+        }
+        else
+        {
+            light.push_back(item);
+        }
+        stats.naive_bytes += 2.0 * (capacity + 1) * sizeof(int);
+    }
+
+    for (int i0 = 0; i0 < (int)light.size(); i0 += block)
+    {
+        int B = std::min((int)light.size() - i0, block);
+        int W = 0;
+        for (int k = 0; k < B; k++)
+        {
+            W = std::max(W, light[i0 + k].weight);
+        }
+
+        std::vector<int> ghost(B * W, 0);
+        std::vector<int> next_ghost(B * W, 0);
+
+        // buf[0, W) is the ghost strip, buf[W, W + t) the tile [a, b]
+        std::vector<int> buf(W + tile);
+
+        for (int a = 0; a <= capacity; a += tile)
+        {
+            int b = std::min(capacity, a + tile - 1);
+            int t = b - a + 1;
+            bool first = a == 0;
+            bool last = b == capacity;
+
+            std::copy(dp.begin() + a, dp.begin() + b + 1, buf.begin() + W);
+
+            for (int k = 0; k < B; k++)
+            {
+                // the first tile never reads its ghost and the last one has
+                // no tile above it to hand a strip to
+                if (!first)
+                {
+                    std::copy(ghost.begin() + k * W, ghost.begin() + (k + 1) * W, buf.begin());
+                }
+                if (!last)
+                {
+                    std::copy(buf.begin() + t, buf.begin() + t + W, next_ghost.begin() + k * W);
+                }
+
+                // column j of the tile is buf[j - a + W]; column 0 is never updated
+                const int w = light[i0 + k].weight;
+                const int lo = W + std::max(std::max(a, 1), w) - a;
+                row_update_inplace(buf.data(), lo, W + t - 1, w, light[i0 + k].value);
+
+                stats.cells += std::max(0, W + t - lo);
+            }
+
+            std::copy(buf.begin() + W, buf.begin() + W + t, dp.begin() + a);
+            std::swap(ghost, next_ghost);
+
+            stats.bytes += (!first + !last) * (double)B * W * sizeof(int);
+        }
+
+        stats.bytes += 2.0 * (capacity + 1) * sizeof(int);
+    }
+
+    return dp[capacity] + weightless_value(items, capacity);
+}
+
+#endif // TILED_H
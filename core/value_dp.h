@@ -0,0 +1,142 @@
+#ifndef VALUE_DP_H
+#define VALUE_DP_H
+
+#include <algorithm>
+#include <climits>
+#include <vector>
+#include "item.h"
+#include "kernel.h"
+
+// DP over values instead of capacities.
+//
+// minw[u] is the least weight that reaches value exactly u, and the answer is
+// the largest u with minw[u] <= C. No feasible set is worth more than the
+// Dantzig (LP) bound, so the table has min(sum(values), bound) + 1 columns,
+// which beats capacity + 1 when values are small and weights huge.
+//
+// Stored negated, the recurrence is the usual 0/1 max recurrence
+//
+//   -minw'[u] = max(-minw[u], -minw[u - v] - w)
+//
+// so the existing row kernels run it with the item's value as the column
+// step and minus its weight as the gain. A value whose least weight is over
+// C is dead for good. Rows start at -(C + 1) and an update only raises an
+// entry, so no stored entry is ever below that; the lowest value an int row
+// has to hold is one take, -(C + 1) - w. When that would wrap (C + w near
+// 2^31), a 64-bit scalar loop takes over.
+
+// Dantzig bound: the LP relaxation, items by efficiency and a fraction of
+// the first one that does not fit. Items with no weight or value are skipped.
+inline long long dantzig_bound(std::vector<Item> items, int capacity)
+{
+    items.erase(std::remove_if(items.begin(), items.end(), [capacity](const Item &item) {
+        return item.value <= 0 || item.weight <= 0 || item.weight > capacity;
+    }), items.end());
+    std::sort(items.begin(), items.end(), [](const Item &a, const Item &b) {
+        return (long long)a.value * b.weight > (long long)b.value * a.weight;
+    });
+
+    long long room = capacity, bound = 0;
+    for (const Item &item : items)
+    {
+        if (item.weight > room)
+        {
+            return bound + room * item.value / item.weight;
+        }
+        room -= item.weight;
+        bound += item.value;
+    }
+    return bound;
+}
+
+struct ValueInstance
+{
+    std::vector<Item> items;    // (value, -weight) of every item that can matter
+    long long total_value;      // columns - 1
+    long long max_weight;
+    long long weightless;       // what weightless items add to the answer
+};
+
+inline ValueInstance value_instance(const std::vector<Item> &items, int capacity)
+{
+    ValueInstance vi;
+    vi.total_value = vi.max_weight = 0;
+    vi.weightless = weightless_value(items, capacity);
+
+    for (const Item &item : items)
+    {
+        if (item.value <= 0 || item.weight > capacity || is_weightless(item))
+        {
+            continue;
+        }
+
+        vi.items.push_back(Item(item.value, -item.weight));
+        vi.total_value += item.value;
+        vi.max_weight = std::max(vi.max_weight, (long long)item.weight);
+    }
+
+    vi.total_value = std::min(vi.total_value, dantzig_bound(items, capacity));
+
+    return vi;
+}
+
+// Index by value when there are far fewer values than capacities
+inline bool prefer_value_dp(const std::vector<Item> &items, int capacity)
+{
+    return 2 * value_instance(items, capacity).total_value < capacity;
+}
+
+// int rows hold every column index and every take, -(C + 1) - w at the lowest
+inline bool value_rows_fit_int(const ValueInstance &vi, int capacity)
+{
+    return vi.total_value < INT_MAX && (long long)capacity + 1 + vi.max_weight <= INT_MAX;
+}
+
+// Largest value whose least weight fits, from the final negated row
+template <typename T>
+inline long long best_value(const T *row, long long columns, int capacity)
+{
+    for (long long u = columns - 1; u > 0; u--)
+    {
+        if (-(long long)row[u] <= capacity)
+        {
+            return u;
+        }
+    }
+    return 0;
+}
+
+inline int knapsack_by_value(const std::vector<Item> &items, int capacity)
+{
+    ValueInstance vi = value_instance(items, capacity);
+    const long long columns = vi.total_value + 1;
+    long long result;
+
+    if (value_rows_fit_int(vi, capacity))
+    {
+        std::vector<int> neg(columns, -capacity - 1);
+        neg[0] = 0;
+        for (const Item &item : vi.items)
+        {
+            row_update_inplace(neg.data(), 1, columns - 1, item.weight, item.value);
+        }
+        result = best_value(neg.data(), columns, capacity);
+    }
+    else
+    {
+        std::vector<long long> neg(columns, LLONG_MIN / 2);
+        neg[0] = 0;
+        for (const Item &item : vi.items)
+        {
+            for (long long u = columns - 1; u >= item.weight; u--)
+            {
+                neg[u] = std::max(neg[u], neg[u - item.weight] + item.value);
+            }
+        }
+        result = best_value(neg.data(), columns, capacity);
+    }
+
+    return result + vi.weightless;
+}
+
+#endif // VALUE_DP_H
@@ -0,0 +1,285 @@
+#ifndef VALUE_WIDTH_H
+#define VALUE_WIDTH_H
+
+#include <algorithm>
+#include <climits>
+#include <vector>
+#include <stdint.h>
+#include <immintrin.h>
+#include "item.h"
+#include "kernel.h"
+#include "value_dp.h"
+
+// DP rows of the narrowest integer type that holds the answer.
+//
+// A cell never exceeds the best value at its capacity, so a bound on the
+// answer bounds every cell and every take (a take is the value of some set
+// that fits). That bound is the Dantzig bound, or C times the best efficiency
+// when any number of copies is allowed. Up to 2^15 - 1 the rows are int16_t,
+// with twice the lanes of int per vector and half the memory traffic. Past
+// 2^31 - 1 they are int64_t, where int rows would wrap silently.
+//
+// The int16_t and int64_t kernels follow the kernel picked with --kernel: the
+// AVX-512 ones (avx512bw for int16_t) under avx512, the AVX2 ones under avx2
+// or when AVX-512BW is missing, and the scalar loop otherwise. int rows use
+// the kernels in kernel.h. Items with no value never change a row and are
+// skipped, so every value fits the row type.
+
+// No set of the items is worth more than this, at any capacity up to C
+inline long long value_bound(const std::vector<Item> &items, int capacity, bool unbounded)
+{
+    if (!unbounded)
+    {
+        return dantzig_bound(items, capacity) + weightless_value(items, capacity);
+    }
+
+    // weightless items are skipped without a copy limit
+    long long bound = 0;
+    for (const Item &item : items)
+    {
+        if (item.weight > 0 && item.weight <= capacity && item.value > 0)
+        {
+            bound = std::max(bound, (long long)capacity * item.value / item.weight);
+        }
+    }
+    return bound;
+}
+
+// Bits per DP value, at least `narrowest`
+inline int value_width(long long bound, int narrowest)
+{
+    int width = bound <= INT16_MAX ? 16 : bound <= INT_MAX ? 32 : 64;
+    return std::max(width, narrowest);
+}
+
+template <typename T>
+inline void row_update_inplace_typed_scalar(T *dp, int lo, int hi, int weight, T value)
+{
+    for (int j = hi; j >= std::max(lo, weight); j--)
+    {
+        const T take = dp[j - weight] + value;
+        dp[j] = dp[j] < take ? take : dp[j];
+    }
+}
+
+template <typename T>
+inline void row_update_unbounded_typed_scalar(T *dp, int lo, int hi, int weight, T value)
+{
+    for (int j = std::max(lo, weight); j <= hi; j++)
+    {
+        const T take = dp[j - weight] + value;
+        dp[j] = dp[j] < take ? take : dp[j];
+    }
+}
+
+__attribute__((target("avx2")))
+inline void row_update_inplace_int16_avx2(int16_t *dp, int lo, int hi, int weight, int16_t value)
+{
+    const int stop = std::max(lo, weight);
+    int j = hi;
+    if (weight >= 16)
+    {
+        const __m256i v = _mm256_set1_epi16(value);
+        for (; j - 15 >= stop; j -= 16)
+        {
+            const __m256i skip = _mm256_loadu_si256((const __m256i *)(dp + j - 15));
+            const __m256i take = _mm256_add_epi16(_mm256_loadu_si256((const __m256i *)(dp + j - 15 - weight)), v);
+            _mm256_storeu_si256((__m256i *)(dp + j - 15), _mm256_max_epi16(skip, take));
+        }
+    }
+    row_update_inplace_typed_scalar(dp, lo, j, weight, value);
+}
+
+__attribute__((target("avx512bw")))
+inline void row_update_inplace_int16_avx512(int16_t *dp, int lo, int hi, int weight, int16_t value)
+{
+    const int stop = std::max(lo, weight);
+    int j = hi;
+    if (weight >= 32)
+    {
+        const __m512i v = _mm512_set1_epi16(value);
+        for (; j - 31 >= stop; j -= 32)
+        {
+            const __m512i skip = _mm512_loadu_si512((const void *)(dp + j - 31));
+            const __m512i take = _mm512_add_epi16(_mm512_loadu_si512((const void *)(dp + j - 31 - weight)), v);
+            _mm512_storeu_si512((void *)(dp + j - 31), _mm512_max_epi16(skip, take));
+        }
+    }
+    row_update_inplace_int16_avx2(dp, lo, j, weight, value);
+}
+
+__attribute__((target("avx2")))
+inline void row_update_unbounded_int16_avx2(int16_t *dp, int lo, int hi, int weight, int16_t value)
+{
+    int j = std::max(lo, weight);
+    if (weight >= 16)
+    {
+        const __m256i v = _mm256_set1_epi16(value);
+        for (; j + 15 <= hi; j += 16)
+        {
+            const __m256i take = _mm256_add_epi16(_mm256_loadu_si256((const __m256i *)(dp + j - weight)), v);
+            _mm256_storeu_si256((__m256i *)(dp + j), _mm256_max_epi16(_mm256_loadu_si256((const __m256i *)(dp + j)), take));
+        }
+    }
+    row_update_unbounded_typed_scalar(dp, j, hi, weight, value);
+}
+
+__attribute__((target("avx512bw")))
+inline void row_update_unbounded_int16_avx512(int16_t *dp, int lo, int hi, int weight, int16_t value)
+{
+    int j = std::max(lo, weight);
+    if (weight >= 32)
+    {
+        const __m512i v = _mm512_set1_epi16(value);
+        for (; j + 31 <= hi; j += 32)
+        {
+            const __m512i take = _mm512_add_epi16(_mm512_loadu_si512((const void *)(dp + j - weight)), v);
+            _mm512_storeu_si512((void *)(dp + j), _mm512_max_epi16(_mm512_loadu_si512((const void *)(dp + j)), take));
+        }
+    }
+    row_update_unbounded_int16_avx2(dp, j, hi, weight, value);
+}
+
+// AVX2 has no 64-bit max, so it is a compare and a blend
+__attribute__((target("avx2")))
+inline void row_update_inplace_int64_avx2(int64_t *dp, int lo, int hi, int weight, int64_t value)
+{
+    const int stop = std::max(lo, weight);
+    int j = hi;
+    if (weight >= 4)
+    {
+        const __m256i v = _mm256_set1_epi64x(value);
+        for (; j - 3 >= stop; j -= 4)
+        {
+            const __m256i skip = _mm256_loadu_si256((const __m256i *)(dp + j - 3));
+            const __m256i take = _mm256_add_epi64(_mm256_loadu_si256((const __m256i *)(dp + j - 3 - weight)), v);
+            _mm256_storeu_si256((__m256i *)(dp + j - 3), _mm256_blendv_epi8(skip, take, _mm256_cmpgt_epi64(take, skip)));
+        }
+    }
+    row_update_inplace_typed_scalar(dp, lo, j, weight, value);
+}
+
+__attribute__((target("avx512f")))
+inline void row_update_inplace_int64_avx512(int64_t *dp, int lo, int hi, int weight, int64_t value)
+{
+    const int stop = std::max(lo, weight);
+    int j = hi;
+    if (weight >= 8)
+    {
+        const __m512i v = _mm512_set1_epi64(value);
+        for (; j - 7 >= stop; j -= 8)
+        {
+            const __m512i skip = _mm512_loadu_si512((const void *)(dp + j - 7));
+            const __m512i take = _mm512_add_epi64(_mm512_loadu_si512((const void *)(dp + j - 7 - weight)), v);
+            _mm512_storeu_si512((void *)(dp + j - 7), _mm512_max_epi64(skip, take));
+        }
+    }
+    row_update_inplace_typed_scalar(dp, lo, j, weight, value);
+}
+
+__attribute__((target("avx2")))
+inline void row_update_unbounded_int64_avx2(int64_t *dp, int lo, int hi, int weight, int64_t value)
+{
+    int j = std::max(lo, weight);
+    if (weight >= 4)
+    {
+        const __m256i v = _mm256_set1_epi64x(value);
+        for (; j + 3 <= hi; j += 4)
+        {
+            const __m256i skip = _mm256_loadu_si256((const __m256i *)(dp + j));
+            const __m256i take = _mm256_add_epi64(_mm256_loadu_si256((const __m256i *)(dp + j - weight)), v);
+            _mm256_storeu_si256((__m256i *)(dp + j), _mm256_blendv_epi8(skip, take, _mm256_cmpgt_epi64(take, skip)));
+        }
+    }
+    row_update_unbounded_typed_scalar(dp, j, hi, weight, value);
+}
+
+__attribute__((target("avx512f")))
+inline void row_update_unbounded_int64_avx512(int64_t *dp, int lo, int hi, int weight, int64_t value)
+{
+    int j = std::max(lo, weight);
+    if (weight >= 8)
+    {
+        const __m512i v = _mm512_set1_epi64(value);
+        for (; j + 7 <= hi; j += 8)
+        {
+            const __m512i take = _mm512_add_epi64(_mm512_loadu_si512((const void *)(dp + j - weight)), v);
+            _mm512_storeu_si512((void *)(dp + j), _mm512_max_epi64(_mm512_loadu_si512((const void *)(dp + j)), take));
+        }
+    }
+    row_update_unbounded_typed_scalar(dp, j, hi, weight, value);
+}
+
+// One row of the 0/1 recurrence (walking down in place) or, with
+// `unbounded`, of the any-number-of-copies one (walking up)
+inline void row_update_typed(int16_t *dp, int lo, int hi, int weight, int value, bool unbounded)
+{
+    const int level = active_kernel.level_bw;
+    if (unbounded && level == 2)
+    {
+        row_update_unbounded_int16_avx512(dp, lo, hi, weight, value);
+    }
+    else if (unbounded && level == 1)
+    {
+        row_update_unbounded_int16_avx2(dp, lo, hi, weight, value);
+    }
+    else if (unbounded)
+    {
+        row_update_unbounded_typed_scalar<int16_t>(dp, lo, hi, weight, value);
+    }
+    else if (level == 2)
+    {
+        row_update_inplace_int16_avx512(dp, lo, hi, weight, value);
+    }
+    else if (level == 1)
+    {
+        row_update_inplace_int16_avx2(dp, lo, hi, weight, value);
+    }
+    else
+    {
+        row_update_inplace_typed_scalar<int16_t>(dp, lo, hi, weight, value);
+    }
+}
+
+inline void row_update_typed(int *dp, int lo, int hi, int weight, int value, bool unbounded)
+{
+    if (unbounded)
+    {
+        row_update_unbounded_inplace(dp, lo, hi, weight, value);
+    }
+    else
+    {
+        row_update_inplace(dp, lo, hi, weight, value);
+    }
+}
+
+inline void row_update_typed(int64_t *dp, int lo, int hi, int weight, int value, bool unbounded)
+{
+    const int level = active_kernel.level;
+    if (unbounded && level == 2)
+    {
+        row_update_unbounded_int64_avx512(dp, lo, hi, weight, value);
+    }
+    else if (unbounded && level == 1)
+    {
+        row_update_unbounded_int64_avx2(dp, lo, hi, weight, value);
+    }
+    else if (unbounded)
+    {
+        row_update_unbounded_typed_scalar<int64_t>(dp, lo, hi, weight, value);
+    }
+    else if (level == 2)
+    {
+        row_update_inplace_int64_avx512(dp, lo, hi, weight, value);
+    }
+    else if (level == 1)
+    {
+        row_update_inplace_int64_avx2(dp, lo, hi, weight, value);
+    }
+    else
+    {
+        row_update_inplace_typed_scalar<int64_t>(dp, lo, hi, weight, value);
+    }
+}
+
+#endif // VALUE_WIDTH_H
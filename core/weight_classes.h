@@ -0,0 +1,200 @@
+#ifndef WEIGHT_CLASSES_H
+#define WEIGHT_CLASSES_H
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <vector>
+#include "item.h"
+#include "kernel.h"
+
+// Knapsack by weight classes.
+//
+// Items of equal weight w are merged into the row in one step. With their
+// values sorted in decreasing order the best k of them are worth the prefix
+// sum P[k], which is concave in k, and
+//
+//   dp'[j] = max_k dp[j - k w] + P[k]     0 <= k <= min(count, C / w)
+//
+// Along one residue class j = r + t w this is a max-plus convolution of an
+// arbitrary sequence with a concave one. The matrix M[t][s] = a[s] + P[t - s]
+// is then Monge, so its row maxima (SMAWK) cost O(C / w) per residue and
+// O(C) per class, instead of O(k C) for k separate item passes.
+
+// Row maxima of a totally monotone matrix given by f(row, col). The rows are
+// first, first + stride, ... (count of them), cols holds ncols ascending
+// columns and scratch has room for 2 * count more; argmax[row] receives the
+// winning column.
+template <typename F>
+void smawk(int first, int stride, int count, const int *cols, int ncols, int *scratch, const F &f, int *argmax)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // REDUCE: keep at most one candidate column per row
+    int *candidates = scratch;
+    int n = 0;
+    for (int i = 0; i < ncols; i++)
+    {
+        while (n > 0 && f(first + (n - 1) * stride, candidates[n - 1]) < f(first + (n - 1) * stride, cols[i]))
+        {
+            n--;
+        }
+        if (n < count)
+        {
+            candidates[n++] = cols[i];
+        }
+    }
+
+    smawk(first + stride, 2 * stride, count / 2, candidates, n, scratch + n, f, argmax);
+
+    // even rows: the answer lies between the answers of the odd rows around them
+    int k = 0;
+    for (int i = 0; i < count; i += 2)
+    {
+        int row = first + i * stride;
+        int last = i + 1 < count ? argmax[row + stride] : candidates[n - 1];
+        int best = candidates[k];
+        long long best_value = f(row, best);
+        while (candidates[k] != last)
+        {
+            k++;
+            long long value = f(row, candidates[k]);
+            if (value > best_value)
+            {
+                best = candidates[k];
+                best_value = value;
+            }
+        }
+        argmax[row] = best;
+    }
+}
+
+// Classes of at most this many items are swept item by item with the row
+// kernel: a vector pass costs well under a nanosecond per cell, a SMAWK
+// merge tens of nanoseconds, so it only pays off for large classes
+#ifndef CLASS_SWEEP_ITEMS
+#define CLASS_SWEEP_ITEMS 128
+#endif
+
+// Merge one class (values sorted high to low, prefix sums in prefix[0..K])
+// into dp
+inline void merge_weight_class(std::vector<int> &dp, int capacity, int weight, const std::vector<long long> &prefix)
+{
+    const int K = prefix.size() - 1;
+
+    // Out-of-band entries (s > t or t - s > K) get a penalty that grows
+    // linearly with the distance. That keeps the extended P concave, so the
+    // matrix stays Monge, and the penalty exceeds anything an entry can be
+    // worth, so such an entry never wins a row.
+    const long long penalty = (long long)dp[capacity] + prefix[K] + 1;
+
+    std::vector<long long> a;
+    std::vector<int> cols, scratch, argmax;
+
+    for (int r = 0; r < weight && r <= capacity; r++)
+    {
+        const int m = (capacity - r) / weight + 1;
+
+        a.resize(m);
+        for (int t = 0; t < m; t++)
+        {
+            a[t] = dp[r + t * weight];
+        }
+
+        auto f = [&](int t, int s) -> long long {
+            int k = t - s;
+            if (k < 0) return a[s] + k * penalty;
+            if (k > K) return a[s] + prefix[K] - (k - K) * penalty;
+            return a[s] + prefix[k];
+        };
+
+        // short bands are cheaper to scan directly
+        if (std::min(K, m - 1) < 8)
+        {
+            for (int t = m - 1; t >= 0; t--)
+            {
+                long long best = a[t];
+                for (int k = 1; k <= std::min(K, t); k++)
+                {
+                    best = std::max(best, a[t - k] + prefix[k]);
+                }
+                dp[r + t * weight] = best;
+            }
+            continue;
+        }
+
+        cols.resize(m);
+        scratch.resize(2 * m);
+        argmax.resize(m);
+        for (int t = 0; t < m; t++)
+        {
+            cols[t] = t;
+        }
+        smawk(0, 1, m, cols.data(), m, scratch.data(), f, argmax.data());
+
+        for (int t = 0; t < m; t++)
+        {
+            dp[r + t * weight] = f(t, argmax[t]);
+        }
+    }
+}
+
+struct ClassStats
+{
+    int classes;      // distinct weights merged
+    long long cells;  // dp cells rewritten, one pass per class
+};
+
+inline int knapsack_weight_classes(const std::vector<Item> &items, int capacity, ClassStats &stats)
+{
+    std::map<int, std::vector<int>> classes;
+
+    for (const Item &item : items)
+    {
+        if (item.value <= 0 || item.weight > capacity || is_weightless(item))
+        {
+            continue;
+        }
+
+        classes[item.weight].push_back(item.value);
+    }
+
+    std::vector<int> dp(capacity + 1, 0);
+    stats.classes = classes.size();
+    stats.cells = (long long)stats.classes * (capacity + 1);
+
+    for (auto &entry : classes)
+    {
+        const int weight = entry.first;
+        std::vector<int> &values = entry.second;
+
+        // at most C / w items of this weight fit
+        int K = std::min((int)values.size(), capacity / weight);
+        std::partial_sort(values.begin(), values.begin() + K, values.end(), std::greater<int>());
+
+        std::vector<long long> prefix(K + 1, 0);
+        for (int k = 1; k <= K; k++)
+        {
+            prefix[k] = prefix[k - 1] + values[k - 1];
+        }
+
+        if (K <= CLASS_SWEEP_ITEMS)
+        {
+            for (int k = 1; k <= K; k++)
+            {
+                row_update_inplace(dp.data(), 1, capacity, weight, values[k - 1]);
+            }
+        }
+        else
+        {
+            merge_weight_class(dp, capacity, weight, prefix);
+        }
+    }
+
+    return dp[capacity] + weightless_value(items, capacity);
+}
+
+#endif // WEIGHT_CLASSES_H
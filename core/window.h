@@ -0,0 +1,59 @@
+#ifndef WINDOW_H
+#define WINDOW_H
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include "item.h"
+
+// Capacity window.
+//
+// After item i only the columns j >= capacity - (weight of the items after i)
+// can still reach dp[n][capacity]: the items left add at most that much
+// weight. Row i therefore only computes [lo[i], capacity], and what it reads
+// from row i-1 (columns j and j - w_i) lies inside row i-1's window, so the
+// cells below the window may hold anything.
+struct CapacityWindow
+{
+    std::vector<int> lo; // first column item i (0-based) has to compute, >= 1
+    long long cells;     // cells inside the windows
+    long long skipped;   // cells of the n x capacity table outside them
+};
+
+// Without `enabled` every row spans the whole capacity
+inline CapacityWindow capacity_window(const std::vector<Item> &items, int capacity, bool enabled)
+{
+    CapacityWindow w;
+    w.lo.assign(items.size(), 1);
+    w.cells = (long long)items.size() * capacity;
+    w.skipped = 0;
+
+    long long remaining = 0;
+    for (int i = (int)items.size() - 1; enabled && i >= 0; i--)
+    {
+        w.lo[i] = (int)std::max(1LL, capacity - remaining);
+        w.skipped += w.lo[i] - 1;
+        remaining += std::max(0, items[i].weight);
+    }
+    w.cells -= w.skipped;
+
+    return w;
+}
+
+// Cells a row update over [lo, hi] actually computes: the kernels leave the
+// columns below the item's weight alone (or just copy them)
+inline long long row_cells(int lo, int hi, int weight)
+{
+    return std::max(0, hi - std::max(lo, weight) + 1);
+}
+
+// `updated` is what the engine ended up computing, for comparison with the
+// planner's estimate
+inline void print_window(const CapacityWindow &w, long long updated)
+{
+    long long total = w.cells + w.skipped;
+    std::cout << "Capacity window: " << w.skipped << " of " << total << " cells skipped ("
+              << (total ? 100.0 * w.skipped / total : 0.0) << "%), " << updated << " cells updated" << std::endl;
+}
+
+#endif // WINDOW_H
@@ -1,4 +1,11 @@
 #include "../core/utils.h"
+#include "../core/kernel.h"
+#include "../core/preprocess.h"
+#include "../core/window.h"
+#include "../core/planner.h"
+#include "../core/fptas.h"
+#include "../core/early_exit.h"
+#include "../core/value_width.h"
 #include "../test/test.h"
 #include <iomanip>
 #include <iostream>
@@ -10,35 +17,130 @@
 #define DEFAULT_NUMBER_OF_THREADS "1"
 
 // MACRO for better readability
-#define DP(i, j) dp[(i) * (capacity+1) + (j)]
+#define DP(i, j) dp[(i) * (columns+1) + (j)]
 
 int world_size;
 int world_rank;
 
-int knapsack_distributed(const std::vector<Item> &items, int capacity)
+// set by --prune: drop items that cannot be in any optimal solution first.
+// Every rank prunes its own copy of the items; the result is deterministic.
+bool prune_first = false;
+
+// set by --window: skip the columns that can no longer reach the final
+// answer. Rows also only ship the window part.
+bool use_window = false;
+
+// set by --order; the plan is deterministic, so every rank plans the same
+std::string item_order_name = "auto";
+
+// set by --epsilon: rows indexed by value, over values scaled down so the
+// answer is within a factor (1 - epsilon) of the optimum (0: exact)
+double epsilon = 0;
+
+// set by --fix: items the bounds prove in or out of every optimal solution
+// leave the instance first, and the fixed-in ones take their capacity along
+bool fix_first = false;
+
+// set by --early-exit: rows between checks against the LP bound, 0 for none.
+// The last rank broadcasts DP(i, capacity) at every check.
+int early_exit_rows = 0;
+
+int knapsack_distributed(const std::vector<Item> &input, int capacity)
 {
   timer total_runtime;
   total_runtime.start();
+
+  Reduction reduction = prune_first ? prune_items(input, capacity) : identity_reduction(input, capacity);
+  if(prune_first && world_rank == 0)
+  {
+    print_reduction(reduction, total_runtime.total());
+  }
+
+  if(fix_first)
+  {
+    timer t_fix;
+    t_fix.start();
+    reduction = fix_items(reduction);
+    if(world_rank == 0)
+    {
+      print_fixing(reduction, t_fix.stop());
+    }
+    capacity = reduction.capacity;
+  }
+
+  reduction = normalize_weights(reduction);
+  if(world_rank == 0)
+  {
+    print_normalization(reduction);
+  }
+  capacity = reduction.capacity;
+
+  timer t_plan;
+  t_plan.start();
+  Plan plan = plan_items(reduction, item_order_name, use_window);
+  if((use_window || plan.order != "input") && world_rank == 0)
+  {
+    print_plan(plan, t_plan.stop());
+  }
+
+  // approximate: the rows hold minus the least weight per scaled value, and
+  // the ranks run the same 0/1 recurrence over (value, -weight) items
+  Approximation approx{};
+  ValueInstance by_value;
+  bool approximate = epsilon > 0;
+  if(approximate)
+  {
+    approx = approximate_values(reduction.items, capacity, epsilon);
+    by_value = value_instance(approx.items, capacity);
+    if(!value_rows_fit_int(by_value, capacity))
+    {
+      if(world_rank == 0)
+      {
+        std::cout << "DP index: capacity (weights or values too large for int rows)" << std::endl;
+      }
+      approximate = false;
+    }
+  }
+
+  const std::vector<Item> &items = approximate ? by_value.items : reduction.items;
+  int columns = approximate ? by_value.total_value : capacity;
+
+  // the ranks exchange int rows, which would wrap past INT_MAX; the serial
+  // engine widens its rows to int64_t for these
+  if(!approximate && value_bound(items, capacity, false) > INT_MAX)
+  {
+    if(world_rank == 0)
+    {
+      std::cout << "Values could pass INT_MAX in int rows, use knapsack_serial" << std::endl;
+    }
+    return -1;
+  }
   
   // define number of items
   int n = items.size();
+  CapacityWindow window = capacity_window(items, columns, use_window);
   
   // define dynamic programming table
-  int *dp = new int[2 * (capacity+1)]();
+  int *dp = new int[2 * (columns+1)]();
+  if(approximate)
+  {
+    std::fill(dp + 1, dp + columns + 1, -capacity - 1);
+  }
 
-  //define capacity index ranges for processes:
-  int base_range = capacity / world_size;
-  int remainder = capacity % world_size;
+  //define column index ranges for processes:
+  int base_range = columns / world_size;
+  int remainder = columns % world_size;
   std::vector<int> indeces(world_size + 1, 1);
-  indeces[world_size] = capacity + 1;
+  indeces[world_size] = columns + 1;
 
   for(int i = 1; i < world_size; i++)
   {
     indeces[i] = indeces[i-1] + base_range;
 
+    // the first `remainder` ranks take one column more
     if(remainder >= 1)
     {
-      indeces[i] += remainder;
+      indeces[i] += 1;
       remainder--;
     }
   }
@@ -47,49 +149,94 @@ int knapsack_distributed(const std::vector<Item> &items, int capacity)
   timer t1;
   t1.start();
 
-  int i;
+  EarlyExit bound = early_exit(items, capacity, approximate ? 0 : early_exit_rows);
+  long long best = 0;
+  int skipped = 0;
+
+  // skipped rows are not stored: r counts the rows computed so far
+  long long cells = 0;
+  int i, r = 0;
   for (i = 1; i <= n; i++)
   {
-    int top = i % 2;
-    int bottom = top != 1;
-
-    for (int j = indeces[world_rank]; j < indeces[world_rank+1]; j++)
+    if(bound.every > 0 && (i - 1) % bound.every == 0)
     {
-      const int weight = items[i-1].weight;
-      const int value = items[i-1].value;
-      const int prev = DP(bottom, j);
-
-      if (weight <= j)
+      int last = DP(r % 2, columns);
+      MPI_Bcast(&last, 1, MPI_INT, world_size - 1, MPI_COMM_WORLD);
+      best = last;
+      if(reached_bound(bound, best))
       {
-        //dp[i][j] = std::max(dp[i-1][j], dp[i-1][j - items[i-1].weight] + items[i-1].value);
-        DP(top, j) = std::max(
-          prev,
-          DP(bottom, j-weight) + value
-        );
-      }
-      else
-      {
-        //dp[i][j] = dp[i-1][j];
-        DP(top, j) = prev;
+        break;
       }
     }
+    if(skip_item(bound, i-1, best))
+    {
+      skipped++;
+      continue;
+    }
+
+    // weightless items are added at the end
+    if(is_weightless(items[i-1]))
+    {
+      continue;
+    }
+
+    int top = (r + 1) % 2;
+    int bottom = r % 2;
+    r++;
+
+    // columns below the window are neither computed nor sent
+    int lo = window.lo[i-1];
+
+    row_update(&DP(bottom, 0), &DP(top, 0), std::max(lo, indeces[world_rank]), indeces[world_rank+1] - 1,
+               items[i-1].weight, items[i-1].value);
+    cells += row_cells(std::max(lo, indeces[world_rank]), indeces[world_rank+1] - 1, items[i-1].weight);
 
     if(world_rank != 0)
     {
-      MPI_Recv(&DP(top, 0), indeces[world_rank], MPI_INT, world_rank-1, i, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+      int from = std::min(lo, indeces[world_rank]);
+      MPI_Recv(&DP(top, from), indeces[world_rank] - from, MPI_INT, world_rank-1, i, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
     }
     if(world_rank != world_size - 1)
     {
-      MPI_Send(&DP(top, 0), indeces[world_rank + 1], MPI_INT, world_rank + 1, i, MPI_COMM_WORLD);
+      int from = std::min(lo, indeces[world_rank + 1]);
+      MPI_Send(&DP(top, from), indeces[world_rank + 1] - from, MPI_INT, world_rank + 1, i, MPI_COMM_WORLD);
     }
   }
 
   double runtime = t1.stop();
 
-  int index = i % 2;
+  // the last row written holds the answer, and every rank returns it
+  int rows_done = i - 1;
+  int index = r % 2;
   int max_value;
-  int value = DP(index, capacity);
-  MPI_Reduce(&value, &max_value, 1, MPI_INT, MPI_MAX, 0, MPI_COMM_WORLD);
+  int value = DP(index, columns);
+  if(approximate)
+  {
+    // largest scaled value in this rank's range whose least weight fits
+    value = 0;
+    for(int u = indeces[world_rank+1] - 1; u >= indeces[world_rank]; u--)
+    {
+      if(-DP(index, u) <= capacity)
+      {
+        value = u;
+        break;
+      }
+    }
+  }
+  MPI_Allreduce(&value, &max_value, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+  long long scaled = max_value;
+  if(approximate)
+  {
+    max_value = approximate_value(approx, scaled, capacity);
+  }
+  else
+  {
+    max_value += weightless_value(items, capacity);
+  }
+  max_value += reduction.fixed_value;
+
+  long long total_cells = 0;
+  MPI_Reduce(&cells, &total_cells, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
 
   double total_time = total_runtime.stop();
 
@@ -110,6 +257,18 @@ int knapsack_distributed(const std::vector<Item> &items, int capacity)
   if(world_rank == 0)
   {
     std::cout << "\nMaximum value achievable: " << max_value << std::endl;
+    if(approximate)
+    {
+      print_approximation(approx, epsilon, scaled, capacity);
+    }
+    if(bound.every > 0)
+    {
+      print_early_exit(rows_done, n, skipped, bound.lp_bound);
+    }
+    if(use_window)
+    {
+      print_window(window, total_cells);
+    }
     std::cout << "Total runtime: " << total_time << " seconds" << std::endl;
   }
 
@@ -132,6 +291,13 @@ int main(int argc, char **argv)
     options.add_options()
         ("n", "Number of items", cxxopts::value<int>()->default_value("1000000"))
         ("c", "Knapsack capacity", cxxopts::value<int>()->default_value("1000"))
+        ("kernel", "DP row kernel: auto, avx512, avx2, sse4.2 or scalar", cxxopts::value< std::string >()->default_value("auto"))
+        ("prune", "Drop items that cannot be in any optimal solution before the DP", cxxopts::value< bool >()->default_value("false"))
+        ("fix", "Fix items the LP and greedy bounds prove in or out of every optimal solution before the DP", cxxopts::value< bool >()->default_value("false"))
+        ("window", "Skip the columns that cannot reach the answer", cxxopts::value< bool >()->default_value("false"))
+        ("order", "Item order: auto, input, weight or efficiency", cxxopts::value< std::string >()->default_value("auto"))
+        ("early-exit", "Every k rows, stop once the best value meets the LP bound and skip items whose bound cannot beat it (0: off)", cxxopts::value< int >()->default_value("0"))
+        ("epsilon", "Approximate: answer at least (1 - epsilon) of the optimum, with a certified bound (0: exact)", cxxopts::value< double >()->default_value("0"))
         ("h,help", "Print usage")
         ("t", "Run tests", cxxopts::value< bool >()->default_value("false"));
         
@@ -147,6 +313,56 @@ int main(int argc, char **argv)
     int n = result["n"].as<int>();
     int capacity = result["c"].as<int>();
     bool run_tests = result["t"].as< bool >();
+    prune_first = result["prune"].as< bool >();
+    use_window = result["window"].as< bool >();
+    epsilon = result["epsilon"].as< double >();
+    if(epsilon > 0 && use_window)
+    {
+        if(world_rank == 0)
+        {
+          std::cout << "--epsilon runs without --window" << std::endl;
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    fix_first = result["fix"].as< bool >();
+    if(fix_first && epsilon > 0)
+    {
+        if(world_rank == 0)
+        {
+          std::cout << "--fix runs without --epsilon" << std::endl;
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    early_exit_rows = std::max(0, result["early-exit"].as< int >());
+    if(early_exit_rows > 0 && epsilon > 0)
+    {
+        if(world_rank == 0)
+        {
+          std::cout << "--early-exit runs without --epsilon" << std::endl;
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    item_order_name = result["order"].as< std::string >();
+    if (!valid_item_order(item_order_name))
+    {
+        if(world_rank == 0)
+        {
+          std::cout << "Unknown item order " << item_order_name << std::endl;
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // choose the DP row kernel for this CPU
+    std::string kernel = result["kernel"].as< std::string >();
+    if (!select_kernel(kernel))
+    {
+        std::cout << "DP kernel " << kernel << " is not supported on this CPU" << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if(world_rank == 0)
+    {
+      std::cout << "DP kernel: " << active_kernel.name << std::endl;
+    }
     
     // run test:
     if (run_tests)
@@ -154,7 +370,14 @@ int main(int argc, char **argv)
         std::cout << std::endl;
         std::cout << "TESTING" << std::endl;
         std::cout << std::endl;
-        test(knapsack_distributed);
+        if(epsilon > 0)
+        {
+          test_approximate(knapsack_distributed, epsilon);
+        }
+        else
+        {
+          test(knapsack_distributed);
+        }
 
         MPI_Finalize();
 
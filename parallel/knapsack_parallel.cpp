@@ -5,10 +5,57 @@
 
 #include "../core/cxxopts.h"
 #include "../core/utils.h"
+#include "../core/kernel.h"
+#include "../core/decision_bits.h"
+#include "../core/reconstruct.h"
+#include "../core/preprocess.h"
+#include "../core/window.h"
+#include "../core/planner.h"
+#include "../core/value_dp.h"
+#include "../core/fptas.h"
+#include "../core/early_exit.h"
+#include "../core/subset_sum.h"
+#include "../core/value_width.h"
 #include "../test/test.h"
 
-// Macro to simplify Dynamic programming traversal
-#define DP(i, j) thread->dp[(i) * (thread->capacity+1) + (j)]
+// Macro to simplify Dynamic programming traversal. Only the last `rows` table
+// rows are kept, so table row i lives in slot i % rows.
+#define DP(i, j) thread->dp[((i) % thread->rows) * (thread->capacity+1) + (j)]
+
+// set by --reconstruct: record decision bits and report the chosen items
+bool reconstruct_items = false;
+
+// largest decision matrix (bytes) kept before falling back to divide and conquer
+size_t decision_bits_budget = 1024UL << 20;
+
+// set by --prune: drop items that cannot be in any optimal solution first
+bool prune_first = false;
+
+// set by --window: skip the columns that can no longer reach the final answer
+bool use_window = false;
+
+// set by --order
+std::string item_order_name = "auto";
+
+// set by --index: capacity, value (least weight per value, same threads and
+// kernels) or auto, which takes value when the values add up to far less
+// than the capacity
+std::string index_mode = "auto";
+
+// set by --epsilon: value index over values scaled down so the answer is
+// within a factor (1 - epsilon) of the optimum (0: exact)
+double epsilon = 0;
+
+// set by --early-exit: rows between checks against the LP bound, 0 for none
+int early_exit_rows = 0;
+
+// set by --fix: items the bounds prove in or out of every optimal solution
+// leave the instance first, and the fixed-in ones take their capacity along
+bool fix_first = false;
+
+// set by --unbounded: any number of copies of every item. Weightless items
+// are skipped, since unlimited copies of them would have unbounded value.
+bool unbounded = false;
 
 // object to handle thread data
 class ThreadData
@@ -18,11 +65,21 @@ class ThreadData
     const std::vector<Item>* items;
     std::atomic<int>*** rowCheck;
     int* dp;
+    DecisionBits* decisions;
+    const int* window;
+    const EarlyExit* bound;
+    int* checkpoint;      // DP(i, capacity) at every check row, set by the last thread
+    int last_row;         // item rows this thread got through
+    int table_row;        // table row holding the last of them
+    int skipped;
+    int rows;
     int start;
     int end;
     int capacity;
     double time;
+    long long cells;
     uint32_t id;
+    uint32_t nThreads;
 };
 
 void parallel_knapsack_function(void* _arg)
@@ -34,50 +91,204 @@ void parallel_knapsack_function(void* _arg)
     ThreadData* thread = (ThreadData*)_arg;
     int n = thread->items->size();
     (*thread->rowCheck)[0][thread->id] = 1;
+    thread->cells = 0;
+    thread->skipped = 0;
+    long long best = 0;
 
-    for (int i = 1; i <= n; i++)
+    // skipped rows are not stored: table row r holds the r-th computed row,
+    // which belongs to item row computed[r]
+    std::vector<int> computed(1, 0);
+    int r = 0;
+
+    int i;
+    for (i = 1; i <= n; i++)
     {
-        
-        if (thread->id != 0) 
+        // every thread reads the same check row, so they all stop and skip
+        // at the same rows
+        const EarlyExit& bound = *thread->bound;
+        if (bound.every > 0 && (i - 1) % bound.every == 0)
         {
-            while ((*thread->rowCheck)[i-1][thread->id-1].load() != 1); // Block 
+            while ((*thread->rowCheck)[i-1][thread->nThreads-1].load() != 1) std::this_thread::yield(); // Block 
+            best = thread->checkpoint[i-1];
+            if (reached_bound(bound, best))
+            {
+                break;
+            }
         }
-
-        for (int j = thread->start; j <= thread->end; j++)
+        // weightless items leave the row as it is and are added at the end
+        const bool weightless = is_weightless((*thread->items)[i-1]);
+        if (weightless || skip_item(bound, i-1, best))
         {
-            const int weight = (*thread->items)[i-1].weight;
-            const int value = (*thread->items)[i-1].value;
-            const int prev = DP(i-1, j);
-
-            if (weight <= j)
+            thread->skipped += !weightless;
+            if (thread->id == thread->nThreads - 1)
             {
-                //dp[i][j] = std::max(dp[i-1][j], dp[i-1][j - items[i-1].weight] + items[i-1].value);
-                DP(i, j) = std::max(
-                    prev,
-                    DP(i-1, j-weight) + value
-                );
+                thread->checkpoint[i] = DP(r, thread->capacity);
             }
-            else
+            (*thread->rowCheck)[i][thread->id].store(1);
+            continue;
+        }
+
+        // row i reads row i-1 anywhere left of this thread's range, so every
+        // thread to the left must have finished that row. Unbounded rows read
+        // row i itself to the left, so the threads run one after another on
+        // a row and overlap across rows instead.
+        const int ready = unbounded ? i : i-1;
+        for (uint32_t k = 0; k < thread->id; k++)
+        {
+            while ((*thread->rowCheck)[ready][k].load() != 1) std::this_thread::yield(); // Block 
+        }
+
+        // table row r+1 overwrites row r+1-rows, which is read by every
+        // thread computing table row r+2-rows
+        if (r + 1 >= thread->rows)
+        {
+            for (uint32_t k = 0; k < thread->nThreads; k++)
             {
-                //dp[i][j] = dp[i-1][j];
-                DP(i, j) = prev;
+                while ((*thread->rowCheck)[computed[r + 2 - thread->rows]][k].load() != 1) std::this_thread::yield(); // Block 
             }
         }
+
+        const Item& item = (*thread->items)[i-1];
+        int lo = std::max(thread->start, thread->window[i-1]);   // empty once the window passes the range
+        if (unbounded)
+        {
+            row_update_unbounded(&DP(r, 0), &DP(r+1, 0), lo, thread->end, item.weight, item.value);
+        }
+        else if (thread->decisions)
+        {
+            row_update_bits(&DP(r, 0), &DP(r+1, 0), lo, thread->end,
+                            item.weight, item.value, thread->decisions->row(i-1));
+        }
+        else
+        {
+            row_update(&DP(r, 0), &DP(r+1, 0), lo, thread->end, item.weight, item.value);
+        }
+        r++;
+        computed.push_back(i);
+        thread->cells += row_cells(lo, thread->end, item.weight);
+        if (thread->id == thread->nThreads - 1)
+        {
+            thread->checkpoint[i] = DP(r, thread->capacity);
+        }
         (*thread->rowCheck)[i][thread->id].store(1);
     }
+    thread->last_row = i - 1;
+    thread->table_row = r;
 
     thread->time = t.stop();
 }
 
 // used pseudocode from:
 // https://en.wikipedia.org/wiki/Knapsack_problem#0-1_knapsack_problem
-int knapsack_parallel_setup(const std::vector<Item> &items, int capacity, uint32_t nThreads) 
+int knapsack_parallel_setup(const std::vector<Item> &input, int capacity, uint32_t nThreads) 
 {
+    timer t_prune;
+    t_prune.start();
+
+    Reduction reduction = prune_first ? prune_items(input, capacity) : identity_reduction(input, capacity);
+    if (prune_first)
+    {
+        print_reduction(reduction, t_prune.stop());
+    }
+
+    if (fix_first)
+    {
+        timer t_fix;
+        t_fix.start();
+        reduction = fix_items(reduction);
+        print_fixing(reduction, t_fix.stop());
+        capacity = reduction.capacity;
+    }
+
+    reduction = normalize_weights(reduction);
+    print_normalization(reduction);
+    capacity = reduction.capacity;
+
+    timer t_plan;
+    t_plan.start();
+    Plan plan = plan_items(reduction, item_order_name, use_window);
+    if (use_window || plan.order != "input")
+    {
+        print_plan(plan, t_plan.stop());
+    }
+
+    // every value the same multiple of its weight: the threads sweep one
+    // reachability bit per capacity instead of int rows
+    if (index_mode == "auto" && !reconstruct_items && !use_window && !unbounded && epsilon <= 0 &&
+        early_exit_rows == 0 && subset_sum_ratio(reduction.items) > 0)
+    {
+        std::cout << "DP index: reachability bits (subset sum, " << ((long long)capacity >> 6) + 1 << " words)" << std::endl;
+
+        timer t;
+        t.start();
+        long long final_value = knapsack_subset_sum(reduction.items, capacity, nThreads) + reduction.fixed_value;
+        double runtime = t.stop();
+
+        // printed exactly, returned saturated at INT_MAX
+        std::cout << "\nMaximum value achievable: " << final_value << std::endl;
+        std::cout << "Total runtime: " << runtime << " seconds" << std::endl;
+        return std::min< long long >(final_value, INT_MAX);
+    }
+
+    // indexed by value the rows hold minus the least weight per value, and
+    // the threads run the same 0/1 recurrence over (value, -weight) items
+    Approximation approx{};
+    if (epsilon > 0)
+    {
+        approx = approximate_values(reduction.items, capacity, epsilon);
+    }
+    ValueInstance by_value = value_instance(epsilon > 0 ? approx.items : reduction.items, capacity);
+    bool value_index = epsilon > 0 || index_mode == "value" || (index_mode == "auto" && !use_window && !reconstruct_items &&
+                       !unbounded && early_exit_rows == 0 && 2 * by_value.total_value < capacity);
+    if (value_index && !value_rows_fit_int(by_value, capacity))
+    {
+        std::cout << "DP index: capacity (weights or values too large for int rows)" << std::endl;
+        value_index = false;
+    }
+    else if (value_index)
+    {
+        std::cout << "DP index: value (" << by_value.total_value + 1 << " columns)" << std::endl;
+    }
+
+    const std::vector<Item> &items = value_index ? by_value.items : reduction.items;
+    int columns = value_index ? by_value.total_value : capacity;
+
+    // the threads share int rows, which would wrap past INT_MAX; the serial
+    // engine widens its rows to int64_t for these
+    if (!value_index && value_bound(items, capacity, unbounded) > INT_MAX)
+    {
+        std::cout << "Values could pass INT_MAX in int rows, use knapsack_serial" << std::endl;
+        return -1;
+    }
+
     // num items
     uint32_t n = items.size();
+    CapacityWindow window = capacity_window(items, columns, use_window);
+    EarlyExit bound = early_exit(items, capacity, value_index ? 0 : early_exit_rows);
+    std::vector<int> checkpoint(n + 1, 0);
 
-    // dynamic programing table
-    int* dp = new int[(n+1) * (capacity+1)]();
+    // dynamic programing table: a ring of rows, enough for threads to run a
+    // few rows apart. The full (n+1) x (columns+1) table is never needed.
+    int rows = std::min(n + 1, 2 * nThreads + 1);
+    int* dp = new int[rows * (columns+1)]();
+    if (value_index)
+    {
+        std::fill(dp + 1, dp + columns + 1, -capacity - 1);
+    }
+
+    // one bit per cell for reconstruction, within --decision-mb and if the
+    // matrix can be allocated; otherwise the items come from the serial
+    // divide and conquer after the sweep
+    DecisionBits* decisions = nullptr;
+    if (reconstruct_items && DecisionBits::bytes(n, columns) <= decision_bits_budget)
+    {
+        decisions = new DecisionBits(n, columns);
+        if (!decisions->bits)
+        {
+            delete decisions;
+            decisions = nullptr;
+        }
+    }
 
     // Create threads
     std::vector<std::thread> threads(nThreads);
@@ -88,14 +299,14 @@ int knapsack_parallel_setup(const std::vector<Item> &items, int capacity, uint32
     // initialize rowcheck 
     std::atomic<int>** rowCheck = new std::atomic<int>*[n+1];
     
-    for(int i = 0; i < n+1; i++)
+    for(uint32_t i = 0; i < n+1; i++)
     {
         rowCheck[i] = new std::atomic<int>[nThreads]();
     }
     
     // Divide work among threads
-    uint32_t itemsPerThread = capacity / nThreads;
-    uint32_t remainder = capacity % nThreads;
+    uint32_t itemsPerThread = columns / nThreads;
+    uint32_t remainder = columns % nThreads;
     
     data[0].start = 1;
     data[0].end = data[0].start + itemsPerThread - 1;
@@ -112,6 +323,17 @@ int knapsack_parallel_setup(const std::vector<Item> &items, int capacity, uint32
         }
     }
 
+    // with a decision matrix every range after the first starts on a
+    // 64-column boundary, so no two threads write the same word of bits
+    if (decisions)
+    {
+        for (uint32_t i = 1; i < nThreads; i++)
+        {
+            data[i].start = std::max(data[i-1].start, data[i].start & ~63);
+            data[i-1].end = data[i].start - 1;
+        }
+    }
+
     // Begin execution timer:
     timer t;
     t.start();
@@ -120,10 +342,16 @@ int knapsack_parallel_setup(const std::vector<Item> &items, int capacity, uint32
     for (uint32_t i = 0; i < nThreads; i++)
     {
         data[i].dp = dp;
+        data[i].decisions = decisions;
+        data[i].window = window.lo.data();
+        data[i].bound = &bound;
+        data[i].checkpoint = checkpoint.data();
+        data[i].rows = rows;
         data[i].items = &items;
         data[i].rowCheck = &rowCheck;
-        data[i].capacity = capacity;
+        data[i].capacity = columns;
         data[i].id = i;
+        data[i].nThreads = nThreads;
 
         threads[i] = std::thread(
             parallel_knapsack_function, 
@@ -149,14 +377,98 @@ int knapsack_parallel_setup(const std::vector<Item> &items, int capacity, uint32
     }
 
     // load final value
-    int final_value = dp[n * (capacity+1) + capacity];
+    // every thread stops after the same row
+    int done = data[0].last_row;
+    int last = data[0].table_row % rows;
+    int final_value = dp[last * (columns+1) + columns] + (unbounded ? 0 : weightless_value(items, capacity));
+    long long scaled = 0;
+    if (value_index)
+    {
+        scaled = best_value(dp + last * (columns+1), columns + 1, capacity);
+        final_value = scaled + by_value.weightless;
+    }
+    if (value_index && epsilon > 0)
+    {
+        final_value = approximate_value(approx, scaled, capacity);
+    }
+    final_value += reduction.fixed_value;
     
     // print total runtime and max value.
     std::cout << "\nMaximum value achievable: " << final_value << std::endl;
+    if (value_index && epsilon > 0)
+    {
+        print_approximation(approx, epsilon, scaled, capacity);
+    }
+    if (bound.every > 0)
+    {
+        print_early_exit(done, n, data[0].skipped, bound.lp_bound);
+    }
+    if (use_window)
+    {
+        long long updated = 0;
+        for (uint32_t i = 0; i < nThreads; i++)
+        {
+            updated += data[i].cells;
+        }
+        print_window(window, updated);
+    }
+
+    if (reconstruct_items)
+    {
+        std::vector<int> chosen;
+        if (decisions)
+        {
+            chosen = decisions->backtrack(items, capacity);
+            add_weightless(items, capacity, chosen);
+            std::sort(chosen.begin(), chosen.end());
+        }
+        else
+        {
+            chosen = knapsack_reconstruct(items, capacity);
+        }
+
+        // the value of the chosen set is what the tests check
+        int weight = 0;
+        final_value = reduction.fixed_value;
+        for (int i : chosen)
+        {
+            final_value += items[i].value;
+            weight += items[i].weight;
+        }
+
+        std::cout << "Reconstruction: " << (decisions ? "bit-packed decision matrix" : "divide and conquer") << std::endl;
+        std::cout << "Items chosen (" << chosen.size() << ", total weight " << (long long)weight * reduction.weight_scale << "):";
+        for (int i : chosen)
+        {
+            std::cout << " " << reduction.index[i];
+        }
+        std::cout << std::endl;
+        if (fix_first)
+        {
+            std::cout << "Items fixed in:";
+            for (int i : reduction.fixed)
+            {
+                std::cout << " " << i;
+            }
+            std::cout << std::endl;
+        }
+
+        if (weight > capacity)
+        {
+            final_value = -1;
+        }
+    }
+
     std::cout << "Total runtime: " << runtime << " seconds" << std::endl;
 
     // memory leak prevention
     delete[] dp;
+    delete decisions;
+    for(uint32_t i = 0; i < n+1; i++)
+    {
+        delete[] rowCheck[i];
+    }
+    delete[] rowCheck;
 
     return final_value;
 }
@@ -169,6 +481,17 @@ int main(int argc, char **argv)
         ("nThreads", "Number of threads", cxxopts::value<uint32_t>()->default_value("1"))
         ("n", "Number of items", cxxopts::value<int>()->default_value("100000"))
         ("c", "Knapsack capacity", cxxopts::value<int>()->default_value("1000"))
+        ("kernel", "DP row kernel: auto, avx512, avx2, sse4.2 or scalar", cxxopts::value< std::string >()->default_value("auto"))
+        ("prune", "Drop items that cannot be in any optimal solution before the DP", cxxopts::value< bool >()->default_value("false"))
+        ("fix", "Fix items the LP and greedy bounds prove in or out of every optimal solution before the DP", cxxopts::value< bool >()->default_value("false"))
+        ("window", "Skip the columns that cannot reach the answer", cxxopts::value< bool >()->default_value("false"))
+        ("order", "Item order: auto, input, weight or efficiency", cxxopts::value< std::string >()->default_value("auto"))
+        ("index", "DP columns: auto, capacity or value (least weight per value)", cxxopts::value< std::string >()->default_value("auto"))
+        ("early-exit", "Every k rows, stop once the best value meets the LP bound and skip items whose bound cannot beat it (0: off)", cxxopts::value< int >()->default_value("0"))
+        ("epsilon", "Approximate: answer at least (1 - epsilon) of the optimum, with a certified bound (0: exact)", cxxopts::value< double >()->default_value("0"))
+        ("unbounded", "Allow any number of copies of every item", cxxopts::value< bool >()->default_value("false"))
+        ("reconstruct", "Also report which items are chosen", cxxopts::value< bool >()->default_value("false"))
+        ("decision-mb", "Memory budget (MB) for the bit-packed decision matrix used by --reconstruct", cxxopts::value< size_t >()->default_value("1024"))
         ("h,help", "Print usage")
         ("t", "Run tests", cxxopts::value< bool >()->default_value("false"));
         
@@ -185,6 +508,55 @@ int main(int argc, char **argv)
     int capacity = result["c"].as<int>();
     uint32_t nThreads = result["nThreads"].as<uint32_t>();
     bool run_tests = result["t"].as< bool >();
+    reconstruct_items = result["reconstruct"].as< bool >();
+    decision_bits_budget = result["decision-mb"].as< size_t >() << 20;
+    prune_first = result["prune"].as< bool >();
+    use_window = result["window"].as< bool >();
+    unbounded = result["unbounded"].as< bool >();
+    index_mode = result["index"].as< std::string >();
+    if (index_mode != "auto" && index_mode != "capacity" && index_mode != "value")
+    {
+        std::cout << "Unknown DP index " << index_mode << std::endl;
+        exit(1);
+    }
+    epsilon = result["epsilon"].as< double >();
+    if ((index_mode == "value" || epsilon > 0) && (reconstruct_items || use_window || unbounded))
+    {
+        std::cout << "--index value and --epsilon run without --reconstruct, --window or --unbounded" << std::endl;
+        exit(1);
+    }
+    if (unbounded && (reconstruct_items || use_window))
+    {
+        std::cout << "--unbounded runs without --reconstruct or --window" << std::endl;
+        exit(1);
+    }
+    fix_first = result["fix"].as< bool >();
+    if (fix_first && (unbounded || epsilon > 0))
+    {
+        std::cout << "--fix runs without --unbounded or --epsilon" << std::endl;
+        exit(1);
+    }
+    early_exit_rows = std::max(0, result["early-exit"].as< int >());
+    if (early_exit_rows > 0 && (reconstruct_items || unbounded || index_mode == "value" || epsilon > 0))
+    {
+        std::cout << "--early-exit runs on capacity rows only, without --reconstruct, --unbounded or --epsilon" << std::endl;
+        exit(1);
+    }
+    item_order_name = result["order"].as< std::string >();
+    if (!valid_item_order(item_order_name))
+    {
+        std::cout << "Unknown item order " << item_order_name << std::endl;
+        exit(1);
+    }
+
+    // choose the DP row kernel for this CPU
+    std::string kernel = result["kernel"].as< std::string >();
+    if (!select_kernel(kernel))
+    {
+        std::cout << "DP kernel " << kernel << " is not supported on this CPU" << std::endl;
+        exit(1);
+    }
+    std::cout << "DP kernel: " << active_kernel.name << std::endl;
     
     // run test:
     if (run_tests)
@@ -192,7 +564,22 @@ int main(int argc, char **argv)
         std::cout << std::endl;
         std::cout << "TESTING" << std::endl;
         std::cout << std::endl;
-        test_threads(knapsack_parallel_setup, nThreads);
+        if (unbounded)
+        {
+            test_unbounded([=](const std::vector<Item> &items, int capacity) {
+                return knapsack_parallel_setup(items, capacity, nThreads);
+            });
+        }
+        else if (epsilon > 0)
+        {
+            test_approximate([=](const std::vector<Item> &items, int capacity) {
+                return knapsack_parallel_setup(items, capacity, nThreads);
+            }, epsilon);
+        }
+        else
+        {
+            test_threads(knapsack_parallel_setup, nThreads);
+        }
 
         return 0;
     }
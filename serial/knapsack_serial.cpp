@@ -1,60 +1,112 @@
 #include <iostream>
+#include <map>
 #include <vector>
 
 #include "../core/cxxopts.h"
+#include "../core/kernel.h"
+#include "../core/reconstruct.h"
+#include "../core/decision_bits.h"
+#include "../core/tiled.h"
+#include "../core/preprocess.h"
+#include "../core/weight_classes.h"
+#include "../core/window.h"
+#include "../core/planner.h"
+#include "../core/bounded.h"
+#include "../core/pareto.h"
+#include "../core/branch_bound.h"
+#include "../core/expanding_core.h"
+#include "../core/value_dp.h"
+#include "../core/fptas.h"
+#include "../core/early_exit.h"
+#include "../core/meet_middle.h"
+#include "../core/subset_sum.h"
+#include "../core/value_width.h"
+#include "../core/fixed_capacity.h"
+#include "../core/batch.h"
 #include "../test/test.h"
 
 
+// set by --window: skip the columns that can no longer reach the final answer
+bool use_window = false;
+
+// set by --unbounded: any number of copies of every item. Weightless items
+// are skipped, since unlimited copies of them would have unbounded value.
+bool unbounded = false;
+
+// set by --early-exit: rows between checks against the LP bound, 0 for none
+int early_exit_rows = 0;
+
+// set by --width: narrowest DP value type in bits (16 lets the bound decide)
+int narrowest_width = 16;
+
 // used pseudocode from:
 // https://en.wikipedia.org/wiki/Knapsack_problem#0-1_knapsack_problem
-int knapsack_serial(const std::vector< Item > &items, int capacity) 
+// T is the DP value type, wide enough for every value the instance reaches
+template < typename T >
+long long knapsack_serial_rows(const std::vector< Item > &items, int capacity) 
 {
     timer t1;
     t1.start();
 
     int n = items.size();
+    CapacityWindow window = capacity_window(items, capacity, use_window);
 
-    // dynamic programing table
+    // dynamic programing table: a single row updated in place, item by item
     //std::vector< std::vector< int >> dp(n+1, std::vector< int >(capacity+1, 0));
-    int *dp = new int[(2 * (capacity+1))]();
+    T *dp = new T[capacity+1]();
+    long long updated = 0;
 
-    // MACRO so that the array indexing is more readable
-    #define DP(i, j) dp[(i) * (capacity+1) + (j)]
+    EarlyExit bound = early_exit(items, capacity, early_exit_rows);
+    long long best = 0;
+    int skipped = 0;
 
     int i;
     for (i = 1; i <= n; i++)
     {
-        int top = i % 2;
-        int bottom = top != 1;
-
-        for (int j = 1; j <= capacity; j++)
+        if (bound.every > 0 && (i - 1) % bound.every == 0)
         {
-        const int weight = items[i-1].weight;
-        const int value = items[i-1].value;
-        const int prev = DP(bottom, j);
+            best = dp[capacity];
+            if (reached_bound(bound, best))
+            {
+                break;
+            }
+        }
+        if (skip_item(bound, i-1, best))
+        {
+            skipped++;
+            continue;
+        }
 
-        if (weight <= j)
+        // weightless items are added at the end
+        if (is_weightless(items[i-1]))
         {
-            //dp[i][j] = std::max(dp[i-1][j], dp[i-1][j - items[i-1].weight] + items[i-1].value);
-            DP(top, j) = std::max(
-            prev,
-            DP(bottom, j-weight) + value
-            );
+            continue;
         }
-        else
+
+        if (!unbounded && items[i-1].value > 0)
         {
-            //dp[i][j] = dp[i-1][j];
-            DP(top, j) = prev;
+            row_update_typed(dp, window.lo[i-1], capacity, items[i-1].weight, items[i-1].value, false);
         }
+        else if (items[i-1].value > 0)
+        {
+            row_update_typed(dp, 1, capacity, items[i-1].weight, items[i-1].value, true);
         }
+        updated += row_cells(window.lo[i-1], capacity, items[i-1].weight);
     }
 
-    int last_index = i % 2;
-    int result = DP(last_index, capacity);
+    long long result = dp[capacity] + (unbounded ? 0 : weightless_value(items, capacity));
     
     double runtime = t1.stop();
 
     std::cout << "\nMaximum value achievable: " << result << std::endl;
+    if (use_window)
+    {
+        print_window(window, updated);
+    }
+    if (bound.every > 0)
+    {
+        print_early_exit(i - 1, n, skipped, bound.lp_bound);
+    }
     std::cout << "Runtime: " << runtime << " seconds" << std::endl;
 
     delete[] dp;
@@ -62,6 +114,477 @@ int knapsack_serial(const std::vector< Item > &items, int capacity)
     return result;
 }
 
+// Rows of int16_t, int or int64_t, from a bound on the best value. The
+// printed value is exact at any width; the returned one saturates at INT_MAX.
+int knapsack_serial(const std::vector< Item > &items, int capacity)
+{
+    long long limit = value_bound(items, capacity, unbounded);
+    int width = value_width(limit, narrowest_width);
+    std::cout << "DP values: int" << width << " (no set is worth more than " << limit << ")" << std::endl;
+
+    long long result = width == 16 ? knapsack_serial_rows< int16_t >(items, capacity) :
+                       width == 32 ? knapsack_serial_rows< int >(items, capacity) :
+                                     knapsack_serial_rows< int64_t >(items, capacity);
+    return std::min< long long >(result, INT_MAX);
+}
+
+// largest decision matrix (bytes) kept before falling back to divide and conquer
+size_t decision_bits_budget = 1024UL << 20;
+
+// input position of each item the engine was handed (empty: the input itself)
+std::vector< int > item_index;
+
+// what the engine's weights were divided by (1: the input weights)
+int weight_scale = 1;
+
+// Same answer as knapsack_serial plus the chosen items. Uses the bit-packed
+// decision matrix when it fits the budget and can be allocated, otherwise the
+// O(capacity) divide and conquer. Returns the value of the chosen set, or -1
+// if it does not fit.
+int knapsack_serial_reconstruct(const std::vector< Item > &items, int capacity)
+{
+    timer t1;
+    t1.start();
+
+    std::vector< int > chosen;
+    bool packed = DecisionBits::bytes(items.size(), capacity) <= decision_bits_budget &&
+                  knapsack_decision_bits(items, capacity, chosen);
+    if (!packed)
+    {
+        chosen = knapsack_reconstruct(items, capacity);
+    }
+
+    int result = 0;
+    int weight = 0;
+    for (int i : chosen)
+    {
+        result += items[i].value;
+        weight += items[i].weight;
+    }
+
+    double runtime = t1.stop();
+
+    std::cout << "\nMaximum value achievable: " << result << std::endl;
+    std::cout << "Reconstruction: " << (packed ? "bit-packed decision matrix" : "divide and conquer") << std::endl;
+    std::cout << "Items chosen (" << chosen.size() << ", total weight " << (long long)weight * weight_scale << "):";
+    for (int i : chosen)
+    {
+        std::cout << " " << (item_index.empty() ? i : item_index[i]);
+    }
+    std::cout << std::endl;
+    std::cout << "Runtime: " << runtime << " seconds" << std::endl;
+
+    return weight <= capacity ? result : -1;
+}
+
+// tile shape for --engine tiled
+int tile_columns = 16384;
+int tile_items = 64;
+
+// Temporally blocked version of knapsack_serial for capacities beyond L2
+int knapsack_serial_tiled(const std::vector< Item > &items, int capacity)
+{
+    timer t1;
+    t1.start();
+
+    TiledStats stats;
+    int result = knapsack_tiled_solve(items, capacity, tile_columns, tile_items, stats);
+
+    double runtime = t1.stop();
+    double seconds = std::max(runtime, 1e-9);
+
+    std::cout << "\nMaximum value achievable: " << result << std::endl;
+    std::cout << "Tile: " << tile_columns << " columns x " << tile_items << " items" << std::endl;
+    std::cout << "Cells updated: " << stats.cells << " (" << stats.cells / seconds / 1e9 << " Gcells/s)" << std::endl;
+    std::cout << "Row traffic: " << stats.bytes / 1e6 << " MB (" << stats.bytes / seconds / 1e9 << " GB/s), "
+              << "an untiled sweep streams " << stats.naive_bytes / 1e6 << " MB" << std::endl;
+    std::cout << "Runtime: " << runtime << " seconds" << std::endl;
+
+    return result;
+}
+
+// Merges all items of one weight at once; wins when many items share few weights
+int knapsack_serial_classes(const std::vector< Item > &items, int capacity)
+{
+    timer t1;
+    t1.start();
+
+    ClassStats stats;
+    int result = knapsack_weight_classes(items, capacity, stats);
+
+    double runtime = t1.stop();
+
+    std::cout << "\nMaximum value achievable: " << result << std::endl;
+    std::cout << "Weight classes: " << stats.classes << " for " << items.size() << " items" << std::endl;
+    std::cout << "Cells updated: " << stats.cells << ", an item-by-item sweep updates "
+              << (long long)items.size() * capacity << std::endl;
+    std::cout << "Runtime: " << runtime << " seconds" << std::endl;
+
+    return result;
+}
+
+// Collapses identical items into one group with a count, then applies each
+// group in a single pass
+int knapsack_serial_bounded(const std::vector< Item > &items, int capacity)
+{
+    timer t1;
+    t1.start();
+
+    std::vector< BoundedItem > groups = merge_duplicates(items);
+    int result = knapsack_bounded(groups, capacity);
+
+    double runtime = t1.stop();
+
+    std::cout << "\nMaximum value achievable: " << result << std::endl;
+    std::cout << "Distinct items: " << groups.size() << " of " << items.size() << std::endl;
+    std::cout << "Runtime: " << runtime << " seconds" << std::endl;
+
+    return result;
+}
+
+// largest Pareto front (states) --engine pareto keeps before going dense
+size_t pareto_cap = 1UL << 22;
+
+// Works on the Pareto-optimal (weight, value) states instead of the capacity
+// columns, so huge capacities cost nothing while the front stays small
+int knapsack_serial_pareto(const std::vector< Item > &items, int capacity)
+{
+    timer t1;
+    t1.start();
+
+    ParetoStats stats;
+    int result = knapsack_pareto(items, capacity, pareto_cap, stats);
+
+    double runtime = t1.stop();
+
+    std::cout << "\nMaximum value achievable: " << result << std::endl;
+    std::cout << "Largest Pareto front: " << stats.largest_front << " states";
+    if (stats.dense_from >= 0)
+    {
+        std::cout << ", dense DP from item " << stats.dense_from << " on";
+    }
+    std::cout << std::endl;
+    std::cout << "Runtime: " << runtime << " seconds" << std::endl;
+
+    return result;
+}
+
+// worker threads for --engine bb
+int search_threads = 1;
+
+// Branch and bound over the items in efficiency order; for few items with
+// capacities or weights far too large for any table
+int knapsack_serial_branch_bound(const std::vector< Item > &items, int capacity)
+{
+    timer t1;
+    t1.start();
+
+    BranchBoundStats stats;
+    int result = knapsack_branch_bound(items, capacity, search_threads, stats);
+
+    double runtime = t1.stop();
+
+    std::cout << "\nMaximum value achievable: " << result << std::endl;
+    std::cout << "Search: " << stats.nodes << " nodes on " << search_threads << " threads, "
+              << stats.steals << " stolen, greedy start " << stats.greedy << std::endl;
+    std::cout << "Runtime: " << runtime << " seconds" << std::endl;
+
+    return result;
+}
+
+// Decides only a core of items around the greedy break item; fast on
+// correlated instances where the DP has to sweep every item
+int knapsack_serial_core(const std::vector< Item > &items, int capacity)
+{
+    timer t1;
+    t1.start();
+
+    CoreStats stats;
+    int result = knapsack_expanding_core(items, capacity, stats);
+
+    double runtime = t1.stop();
+
+    std::cout << "\nMaximum value achievable: " << result << std::endl;
+    std::cout << "Core: " << stats.core << " items, at most " << stats.largest << " states" << std::endl;
+    std::cout << "Runtime: " << runtime << " seconds" << std::endl;
+
+    return result;
+}
+
+// Horowitz-Sahni: Pareto subset sums of both halves and a two-pointer sweep;
+// for up to ~45 items with any capacity
+int knapsack_serial_meet(const std::vector< Item > &items, int capacity)
+{
+    timer t1;
+    t1.start();
+
+    MeetStats stats;
+    int result = knapsack_horowitz_sahni(items, capacity, stats);
+
+    double runtime = t1.stop();
+
+    std::cout << "\nMaximum value achievable: " << result << std::endl;
+    std::cout << "Half lists: " << stats.left << " and " << stats.right << " Pareto sums" << std::endl;
+    std::cout << "Runtime: " << runtime << " seconds" << std::endl;
+
+    return result;
+}
+
+// Schroeppel-Shamir: the same sweep over sums streamed from heaps of quarter
+// lists, in O(2^(n/4)) memory
+int knapsack_serial_schroeppel_shamir(const std::vector< Item > &items, int capacity)
+{
+    timer t1;
+    t1.start();
+
+    MeetStats stats;
+    int result = knapsack_schroeppel_shamir(items, capacity, stats);
+
+    double runtime = t1.stop();
+
+    std::cout << "\nMaximum value achievable: " << result << std::endl;
+    std::cout << "Sums streamed: " << stats.left << " left, " << stats.right << " right" << std::endl;
+    std::cout << "Runtime: " << runtime << " seconds" << std::endl;
+
+    return result;
+}
+
+// Subset sum (every value equals its weight): one reachability bit per
+// capacity, shifted and ORed in a word at a time, on --threads threads. The
+// printed value is exact; the returned one saturates at INT_MAX.
+int knapsack_serial_subset_sum(const std::vector< Item > &items, int capacity)
+{
+    timer t1;
+    t1.start();
+
+    long long result = knapsack_subset_sum(items, capacity, search_threads);
+
+    double runtime = t1.stop();
+
+    std::cout << "\nMaximum value achievable: " << result << std::endl;
+    std::cout << "Reachability words: " << ((long long)capacity >> 6) + 1 << " on " << search_threads << " threads" << std::endl;
+    std::cout << "Runtime: " << runtime << " seconds" << std::endl;
+
+    return std::min< long long >(result, INT_MAX);
+}
+
+// Indexes the DP by value: the least weight for every achievable value
+int knapsack_serial_value(const std::vector< Item > &items, int capacity)
+{
+    timer t1;
+    t1.start();
+
+    int result = knapsack_by_value(items, capacity);
+
+    double runtime = t1.stop();
+
+    std::cout << "\nMaximum value achievable: " << result << std::endl;
+    std::cout << "Value columns: " << value_instance(items, capacity).total_value + 1
+              << " instead of " << (long long)capacity + 1 << " capacity columns" << std::endl;
+    std::cout << "Runtime: " << runtime << " seconds" << std::endl;
+
+    return result;
+}
+
+// set by --epsilon: answer within a factor (1 - epsilon) of the optimum
+double epsilon = 0;
+
+// Value-indexed DP over values scaled down until the table has at most
+// n^2 / epsilon columns; reports the answer and a certified bound
+int knapsack_serial_fptas(const std::vector< Item > &items, int capacity)
+{
+    timer t1;
+    t1.start();
+
+    Approximation approx = approximate_values(items, capacity, epsilon);
+    long long scaled = knapsack_scaled(approx, capacity);
+    int result = approximate_value(approx, scaled, capacity);
+
+    double runtime = t1.stop();
+
+    std::cout << "\nMaximum value achievable: " << result << std::endl;
+    print_approximation(approx, epsilon, scaled, capacity);
+    std::cout << "Runtime: " << runtime << " seconds" << std::endl;
+
+    return result;
+}
+
+// Capacities up to FIXED_CAPACITY_MAX on stack rows of a length fixed at
+// compile time (knapsack_fixed<C>); larger ones, and values that could wrap
+// the int rows, go to dp
+int knapsack_serial_fixed(const std::vector< Item > &items, int capacity)
+{
+    if (capacity > FIXED_CAPACITY_MAX)
+    {
+        std::cout << "Capacity over " << FIXED_CAPACITY_MAX << ", running dp" << std::endl;
+        return knapsack_serial(items, capacity);
+    }
+    if (value_bound(items, capacity, false) > INT_MAX)
+    {
+        std::cout << "Values could pass INT_MAX, running dp" << std::endl;
+        return knapsack_serial(items, capacity);
+    }
+
+    timer t1;
+    t1.start();
+
+    int result = knapsack_fixed_capacity(items, capacity);
+
+    double runtime = t1.stop();
+
+    std::cout << "\nMaximum value achievable: " << result << std::endl;
+    std::cout << "Runtime: " << runtime << " seconds" << std::endl;
+
+    return result;
+}
+
+// dp, the bitset when every value equals its weight, fixed rows for small
+// capacities, or the value-indexed DP when the values add up to far less
+// than the capacity. None but dp has a capacity window, unbounded mode or
+// early exit.
+int knapsack_serial_auto(const std::vector< Item > &items, int capacity)
+{
+    if (!unbounded && !use_window && early_exit_rows == 0 && subset_sum_ratio(items) > 0)
+    {
+        std::cout << "Engine: subset (every value equals its weight)" << std::endl;
+        return knapsack_serial_subset_sum(items, capacity);
+    }
+    if (!unbounded && !use_window && early_exit_rows == 0 && capacity <= FIXED_CAPACITY_MAX &&
+        value_bound(items, capacity, false) <= INT_MAX)
+    {
+        std::cout << "Engine: fixed (capacity at most " << FIXED_CAPACITY_MAX << ")" << std::endl;
+        return knapsack_serial_fixed(items, capacity);
+    }
+    if (!unbounded && !use_window && early_exit_rows == 0 && prefer_value_dp(items, capacity))
+    {
+        std::cout << "Engine: value (values add up to far less than the capacity)" << std::endl;
+        return knapsack_serial_value(items, capacity);
+    }
+    return knapsack_serial(items, capacity);
+}
+
+// solvers selectable with --engine, all with the signature test() drives
+typedef int (*Engine)(const std::vector< Item > &items, int capacity);
+
+const std::map< std::string, Engine > engines = {
+    {"dp", knapsack_serial},
+    {"tiled", knapsack_serial_tiled},
+    {"classes", knapsack_serial_classes},
+    {"bounded", knapsack_serial_bounded},
+    {"pareto", knapsack_serial_pareto},
+    {"bb", knapsack_serial_branch_bound},
+    {"core", knapsack_serial_core},
+    {"value", knapsack_serial_value},
+    {"mitm", knapsack_serial_meet},
+    {"ss", knapsack_serial_schroeppel_shamir},
+    {"subset", knapsack_serial_subset_sum},
+    {"fixed", knapsack_serial_fixed},
+    {"auto", knapsack_serial_auto},
+};
+
+// set from the command line
+Engine engine = knapsack_serial_auto;
+bool prune = false;
+bool fix = false;
+std::string item_order_name = "auto";
+
+// Preprocess and order the items, then hand what is left to the selected engine
+int knapsack_solve(const std::vector< Item > &items, int capacity)
+{
+    timer t1;
+    t1.start();
+
+    Reduction reduction = prune ? prune_items(items, capacity) : identity_reduction(items, capacity);
+    if (prune)
+    {
+        print_reduction(reduction, t1.stop());
+    }
+
+    if (fix)
+    {
+        timer t3;
+        t3.start();
+        reduction = fix_items(reduction);
+        print_fixing(reduction, t3.stop());
+    }
+
+    reduction = normalize_weights(reduction);
+    print_normalization(reduction);
+
+    timer t2;
+    t2.start();
+    Plan plan = plan_items(reduction, item_order_name, use_window);
+    if (use_window || plan.order != "input")
+    {
+        print_plan(plan, t2.stop());
+    }
+
+    item_index = reduction.index;
+    weight_scale = reduction.weight_scale;
+    int result = engine(reduction.items, reduction.capacity);
+    item_index.clear();
+    weight_scale = 1;
+
+    if (fix)
+    {
+        // a reconstruction that did not fit stays -1
+        result = result < 0 ? result : result + reduction.fixed_value;
+        std::cout << "Maximum value with the fixed items: " << result << std::endl;
+        if (engine == knapsack_serial_reconstruct)
+        {
+            std::cout << "Items fixed in:";
+            for (int i : reduction.fixed)
+            {
+                std::cout << " " << i;
+            }
+            std::cout << std::endl;
+        }
+    }
+
+    return result;
+}
+
+// --batch: `count` random instances of n items with capacities in
+// [capacity/2, capacity], solved as a batch and then by one knapsack_serial
+// call each, the way a caller without the batch would solve them
+void knapsack_serial_batch(int count, int n, int capacity)
+{
+    std::vector< std::vector< Item > > instances(count);
+    std::vector< int > capacities(count);
+    srand(n);
+    for (int k = 0; k < count; k++)
+    {
+        capacities[k] = capacity / 2 + rand() % (capacity / 2 + 1);
+        for (int i = 0; i < n; i++)
+        {
+            instances[k].push_back(Item(rand() % std::max(1, capacity) + 1, rand() % 100 + 1));
+        }
+    }
+    std::cout << "\nInstances: " << count << " of " << n << " items, capacity up to " << capacity << std::endl;
+
+    timer t1;
+    t1.start();
+    std::vector< int > best = knapsack_batch(instances, capacities);
+    double batched = t1.stop();
+
+    // the per-call lines of knapsack_serial go nowhere instead of to the terminal
+    std::streambuf *shown = std::cout.rdbuf(nullptr);
+    timer t2;
+    t2.start();
+    long long mismatches = 0;
+    for (int k = 0; k < count; k++)
+    {
+        mismatches += knapsack_serial(instances[k], capacities[k]) != best[k];
+    }
+    double single = t2.stop();
+    std::cout.rdbuf(shown);
+    std::cout.clear();
+
+    std::cout << "Batch: " << batched << " seconds (" << count / std::max(batched, 1e-9) << " instances per second)" << std::endl;
+    std::cout << "knapsack_serial, one at a time: " << single << " seconds (" << count / std::max(single, 1e-9) << " instances per second)" << std::endl;
+    std::cout << "Answers that differ: " << mismatches << std::endl;
+}
+
 int main(int argc, char **argv)
 {
     cxxopts::Options options("Knapsack_Serial", "Serial implementation of 0/1 knapsack problem");
@@ -69,6 +592,25 @@ int main(int argc, char **argv)
     options.add_options()
         ("n", "Number of items", cxxopts::value<int>()->default_value("100000"))
         ("c", "Knapsack capacity", cxxopts::value<int>()->default_value("1000"))
+        ("copies", "Copies of each random item", cxxopts::value<int>()->default_value("1"))
+        ("instance", "Random values: uncorrelated, weak or strong (correlation with the weight)", cxxopts::value< std::string >()->default_value("uncorrelated"))
+        ("kernel", "DP row kernel: auto, avx512, avx2, sse4.2 or scalar", cxxopts::value< std::string >()->default_value("auto"))
+        ("engine", "Solver: auto, dp, tiled, classes, bounded, pareto, bb, core, value, mitm, ss, subset or fixed", cxxopts::value< std::string >()->default_value("auto"))
+        ("tile", "Capacity columns per tile (--engine tiled)", cxxopts::value< int >()->default_value("16384"))
+        ("tile-items", "Items applied to a tile before moving on (--engine tiled)", cxxopts::value< int >()->default_value("64"))
+        ("prune", "Drop items that cannot be in any optimal solution before the DP", cxxopts::value< bool >()->default_value("false"))
+        ("fix", "Fix items the LP and greedy bounds prove in or out of every optimal solution before the DP", cxxopts::value< bool >()->default_value("false"))
+        ("window", "Skip the columns that cannot reach the answer", cxxopts::value< bool >()->default_value("false"))
+        ("order", "Item order: auto, input, weight or efficiency", cxxopts::value< std::string >()->default_value("auto"))
+        ("pareto-cap", "Pareto states kept before falling back to the dense DP (--engine pareto)", cxxopts::value< size_t >()->default_value("4194304"))
+        ("threads", "Worker threads (--engine bb or subset)", cxxopts::value< int >()->default_value("1"))
+        ("batch", "Solve this many random instances of -n items (capacity up to -c) as a lockstep batch (0: off)", cxxopts::value< int >()->default_value("0"))
+        ("width", "Narrowest DP value type for --engine dp: 16, 32 or 64 bits (wider when the value bound needs it)", cxxopts::value< int >()->default_value("16"))
+        ("unbounded", "Allow any number of copies of every item (--engine dp)", cxxopts::value< bool >()->default_value("false"))
+        ("reconstruct", "Also report which items are chosen", cxxopts::value< bool >()->default_value("false"))
+        ("early-exit", "Every k rows, stop once the best value meets the LP bound and skip items whose bound cannot beat it (--engine dp, 0: off)", cxxopts::value< int >()->default_value("0"))
+        ("epsilon", "Approximate: answer at least (1 - epsilon) of the optimum, with a certified bound (0: exact)", cxxopts::value< double >()->default_value("0"))
+        ("decision-mb", "Memory budget (MB) for the bit-packed decision matrix used by --reconstruct", cxxopts::value< size_t >()->default_value("1024"))
         ("h,help", "Print usage")
         ("t", "Run tests", cxxopts::value< bool >()->default_value("false"));
         
@@ -83,7 +625,75 @@ int main(int argc, char **argv)
     // Get parameters
     int n = result["n"].as<int>();
     int capacity = result["c"].as<int>();
+    int copies = std::max(1, result["copies"].as<int>());
+    std::string instance = result["instance"].as< std::string >();
     bool run_tests = result["t"].as< bool >();
+    int batch = std::max(0, result["batch"].as< int >());
+    bool reconstruct = result["reconstruct"].as< bool >();
+    decision_bits_budget = result["decision-mb"].as< size_t >() << 20;
+    tile_columns = std::max(1, result["tile"].as< int >());
+    tile_items = std::max(1, result["tile-items"].as< int >());
+    pareto_cap = result["pareto-cap"].as< size_t >();
+    search_threads = std::max(1, result["threads"].as< int >());
+    narrowest_width = result["width"].as< int >();
+    if (narrowest_width != 16 && narrowest_width != 32 && narrowest_width != 64)
+    {
+        std::cout << "DP value width " << narrowest_width << " is not 16, 32 or 64" << std::endl;
+        exit(1);
+    }
+
+    std::string engine_name = result["engine"].as< std::string >();
+    if (!engines.count(engine_name))
+    {
+        std::cout << "Unknown engine " << engine_name << std::endl;
+        exit(1);
+    }
+    engine = reconstruct ? knapsack_serial_reconstruct : engines.at(engine_name);
+    prune = result["prune"].as< bool >();
+    fix = result["fix"].as< bool >();
+    use_window = result["window"].as< bool >();
+    unbounded = result["unbounded"].as< bool >();
+    if (unbounded && ((engine != knapsack_serial && engine != knapsack_serial_auto) || use_window))
+    {
+        std::cout << "--unbounded runs on --engine dp only, without --reconstruct or --window" << std::endl;
+        exit(1);
+    }
+    early_exit_rows = std::max(0, result["early-exit"].as< int >());
+    if (early_exit_rows > 0 && (unbounded || (engine != knapsack_serial && engine != knapsack_serial_auto)))
+    {
+        std::cout << "--early-exit runs on --engine dp only, without --reconstruct or --unbounded" << std::endl;
+        exit(1);
+    }
+    if (fix && unbounded)
+    {
+        std::cout << "--fix runs without --unbounded" << std::endl;
+        exit(1);
+    }
+    epsilon = result["epsilon"].as< double >();
+    if (epsilon > 0)
+    {
+        if (reconstruct || unbounded || use_window || early_exit_rows > 0 || fix || engine_name != "auto")
+        {
+            std::cout << "--epsilon replaces --engine and runs without --reconstruct, --unbounded, --window, --early-exit or --fix" << std::endl;
+            exit(1);
+        }
+        engine = knapsack_serial_fptas;
+    }
+    item_order_name = result["order"].as< std::string >();
+    if (!valid_item_order(item_order_name))
+    {
+        std::cout << "Unknown item order " << item_order_name << std::endl;
+        exit(1);
+    }
+
+    // choose the DP row kernel for this CPU
+    std::string kernel = result["kernel"].as< std::string >();
+    if (!select_kernel(kernel))
+    {
+        std::cout << "DP kernel " << kernel << " is not supported on this CPU" << std::endl;
+        exit(1);
+    }
+    std::cout << "DP kernel: " << active_kernel.name << std::endl;
 
     // run test:
     if (run_tests)
@@ -91,10 +701,35 @@ int main(int argc, char **argv)
         std::cout << std::endl;
         std::cout << "TESTING" << std::endl;
         std::cout << std::endl;
-        test(knapsack_serial);
+        if (batch > 0)
+        {
+            test_batch(knapsack_batch);
+        }
+        else if (unbounded)
+        {
+            test_unbounded(knapsack_solve);
+        }
+        else if (epsilon > 0)
+        {
+            test_approximate(knapsack_solve, epsilon);
+        }
+        else if (engine == knapsack_serial_subset_sum)
+        {
+            test_subset_sum(knapsack_solve);
+        }
+        else
+        {
+            test(knapsack_solve);
+        }
 
         return 0;
     }
+
+    if (batch > 0)
+    {
+        knapsack_serial_batch(batch, n, capacity);
+        return 0;
+    }
     
     // Create sample items for testing
     std::vector< Item > items;
@@ -106,16 +741,22 @@ int main(int argc, char **argv)
     {
         int w = rand() % (capacity/2) + 1;  // weight between 1 and capacity/2
         int v = rand() % 100 + 1;  // value between 1 and 100
-        items.push_back(Item(w, v));
+        if (instance == "weak")
+        {
+            v = std::max(1, w + rand() % (capacity/10 + 1) - capacity/20);  // weight +- capacity/20
+        }
+        else if (instance == "strong")
+        {
+            v = w + capacity/20;  // weight + capacity/20
+        }
+        items.insert(items.end(), copies, Item(w, v));
     }
     
     // Print items
-    std::cout << "\nItems available:" << n << std::endl;
+    std::cout << "\nItems available:" << items.size() << std::endl;
     std::cout << "Knapsack capacity: " << capacity << std::endl;
     
-    knapsack_serial(items, capacity);
+    knapsack_solve(items, capacity);
     
     return 0;
 }
-
-#undef DP
\ No newline at end of file
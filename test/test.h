@@ -1,8 +1,63 @@
+#include <functional>
 #include <iostream>
+#include <sstream>
+#include <string>
 #include <vector>
 #include "../core/utils.h"
 #include "../core/item.h"
 
+// One instance and its best value
+struct TestCase
+{
+    std::string name;
+    std::vector< Item > items;
+    int capacity;
+    int expected;
+};
+
+// Print the numbered line of one case
+void report(int testNum, const std::string &name, bool passed, const std::string &expected, long long result)
+{
+    std::cout << "Test " << testNum << ": " << name << " - ";
+    if(passed)
+        std::cout << "PASSED" << std::endl;
+    else
+        std::cout << "FAILED (Expected " << expected << ", got " << result << ")" << std::endl;
+}
+
+// Run every case, numbered from testNum; `label` tags the mode under test
+void run_cases(const std::vector< TestCase > &cases, const std::function<int(const std::vector< Item > &items, int capacity)> &function,
+               const std::string &label, int testNum = 1)
+{
+    for (const TestCase &c : cases)
+    {
+        int result = function(c.items, c.capacity);
+        report(testNum++, c.name + label, result == c.expected, std::to_string(c.expected), result);
+    }
+}
+
+// Cases after the first nine, shared by test() and test_threads()
+std::vector< TestCase > shared_cases()
+{
+    // Many copies of a few items, more copies of the heaviest than fit
+    std::vector< Item > copies(40, Item(3, 5));
+    copies.insert(copies.end(), 25, Item(7, 12));
+    copies.insert(copies.end(), 10, Item(11, 20));
+
+    return {
+        {"Weights wider than a vector register",
+         {Item(17, 30), Item(23, 41), Item(31, 50), Item(40, 66), Item(19, 29), Item(52, 88)}, 103, 168},
+        {"Capacity past the reconstruction base case",
+         {Item(40000, 30), Item(50000, 45), Item(70000, 60), Item(10, 5)}, 100000, 80},
+        {"Weightless item", {Item(0, 85), Item(1, 135)}, 1, 220},
+        {"Many copies of a few items", copies, 100, 180},
+        {"Weights sharing a divisor",
+         {Item(10, 7), Item(25, 12), Item(35, 20), Item(40, 22), Item(15, 9), Item(90, 50)}, 83, 43},
+        {"Values past 16 bits", {Item(10, 20000), Item(10, 20000), Item(5, 15000), Item(1, 1)}, 20, 40000},
+    };
+}
+
+
 void test(int (*function)(const std::vector< Item > &items, int capacity)) 
 {
     int testNum = 1;
@@ -133,6 +188,8 @@ void test(int (*function)(const std::vector< Item > &items, int capacity))
         else
             std::cout << "FAILED (Expected " << expected << ", got " << result << ")" << std::endl;
     }
+
+    run_cases(shared_cases(), function, "", testNum);
 }
 
 
@@ -267,4 +324,133 @@ void test_threads(int (*function)(const std::vector< Item > &items, int capacity
         else
             std::cout << "FAILED (Expected " << expected << ", got " << result << ")" << std::endl;
     }
-}
\ No newline at end of file
+
+    run_cases(shared_cases(), [&](const std::vector< Item > &items, int capacity) {
+        return function(items, capacity, nThreads);
+    }, "", testNum);
+}
+
+// Same checks with any number of copies of every item allowed. Takes any
+// callable so the threaded engines can bind their thread count.
+void test_unbounded(const std::function<int(const std::vector< Item > &items, int capacity)> &function)
+{
+    run_cases({
+        {"Basic test with small numbers", {Item(2, 3), Item(3, 4), Item(4, 5), Item(5, 6)}, 10, 15},
+        {"Several ways to fill the capacity", {Item(1, 1), Item(3, 4), Item(4, 5), Item(5, 7)}, 7, 9},
+        {"Zero capacity", {Item(2, 3), Item(3, 4)}, 0, 0},
+        {"Items too heavy for capacity", {Item(10, 20), Item(15, 30)}, 5, 0},
+        {"Weights wider than a vector register",
+         {Item(17, 30), Item(23, 41), Item(31, 50), Item(40, 66), Item(19, 29), Item(52, 88)}, 103, 183},
+        {"Many copies of the same item", {Item(16, 33), Item(20, 41), Item(37, 77)}, 1000, 2079},
+    }, function, " (unbounded)");
+}
+
+// Approximate engines: the answer must lie in [(1 - epsilon) expected, expected]
+void test_approximate(const std::function<int(const std::vector< Item > &items, int capacity)> &function, double epsilon)
+{
+    std::vector< TestCase > cases = {
+        {"Basic test with small numbers", {Item(2, 3), Item(3, 4), Item(4, 5), Item(5, 6)}, 10, 13},
+        {"Large values", {Item(12, 9000), Item(7, 5210), Item(11, 8100), Item(8, 6030), Item(9, 6650), Item(5, 3600)}, 26, 19340},
+        {"Weightless item", {Item(0, 500), Item(30, 20000), Item(18, 12500), Item(22, 14800), Item(13, 8300)}, 53, 36100},
+        {"Zero capacity", {Item(2, 3), Item(3, 4)}, 0, 0},
+        {"Sixty items", {}, 300, 158375},
+    };
+    for (int i = 0; i < 60; i++)
+    {
+        cases[4].items.push_back(Item((i * 37) % 50 + 1, 1000 + (i * 7919) % 9000));
+    }
+
+    int testNum = 1;
+    for (const TestCase &c : cases)
+    {
+        int result = function(c.items, c.capacity);
+        double least = (1 - epsilon) * c.expected;
+        std::ostringstream label, bound;
+        label << c.name << " (epsilon " << epsilon << ")";
+        bound << c.expected << " or at least " << least;
+        report(testNum++, label.str(), result <= c.expected && result >= least, bound.str(), result);
+    }
+}
+
+// Subset sum: every value equals its weight
+void test_subset_sum(const std::function<int(const std::vector< Item > &items, int capacity)> &function)
+{
+    std::vector< std::vector< int > > weights = {
+        {3, 5, 7, 11},
+        {70, 130, 200, 64, 1},
+        {37, 41, 43},
+        {2, 3},
+        {64, 128, 192, 256},
+        {},
+    };
+    for (int i = 1; i <= 60; i++)
+    {
+        weights[5].push_back(i * i + 17);
+    }
+
+    std::vector< TestCase > cases = {
+        {"Basic test with small numbers", {}, 20, 19},
+        {"Weights wider than a word", {}, 265, 265},
+        {"Only a few sums fit", {}, 79, 78},
+        {"Zero capacity", {}, 0, 0},
+        {"Word-aligned weights", {}, 1000, 640},
+        {"Sixty items", {}, 20011, 20011},
+    };
+    for (size_t k = 0; k < cases.size(); k++)
+    {
+        for (int w : weights[k])
+        {
+            cases[k].items.push_back(Item(w, w));
+        }
+    }
+
+    run_cases(cases, function, " (subset sum)");
+}
+
+// Batch engines: every instance of one call, then many of them mixed
+void test_batch(const std::function<std::vector<int>(const std::vector< std::vector< Item > > &items,
+                                                     const std::vector< int > &capacities)> &function)
+{
+    std::vector< TestCase > cases = {
+        {"Basic test with small numbers", {Item(5, 10), Item(4, 40), Item(6, 30), Item(3, 50)}, 10, 90},
+        {"Zero capacity", {Item(1, 5)}, 0, 0},
+        {"Weightless item", {Item(0, 7), Item(3, 4)}, 3, 11},
+        {"Item heavier than the capacity", {Item(20, 100), Item(2, 3)}, 5, 3},
+        {"No items", {}, 10, 0},
+        {"Capacity past lockstep", {Item(10, 60), Item(20, 100), Item(30, 120)}, 50, 220},
+        {"Capacity past the fixed rows", {Item(100, 1), Item(150, 2), Item(120, 3), Item(200, 4)}, 300, 5},
+        {"Weights wider than a vector", {Item(17, 30), Item(18, 31), Item(14, 20)}, 32, 51},
+    };
+
+    // one call with every case, then forty in a scrambled order, across several groups
+    std::vector< std::vector< Item > > instances, mixed;
+    std::vector< int > capacities, expected, mixed_capacities, mixed_expected;
+    for (const TestCase &c : cases)
+    {
+        instances.push_back(c.items);
+        capacities.push_back(c.capacity);
+        expected.push_back(c.expected);
+    }
+    for (size_t i = 0; i < 40; i++)
+    {
+        size_t k = (i * 3) % cases.size();
+        mixed.push_back(instances[k]);
+        mixed_capacities.push_back(capacities[k]);
+        mixed_expected.push_back(expected[k]);
+    }
+
+    int testNum = 1;
+    std::vector< int > result = function(instances, capacities);
+    for (size_t k = 0; k < cases.size(); k++)
+    {
+        report(testNum++, cases[k].name + " (batch)", result[k] == expected[k], std::to_string(expected[k]), result[k]);
+    }
+
+    std::vector< int > mixed_result = function(mixed, mixed_capacities);
+    int wrong = 0;
+    for (size_t i = 0; i < mixed.size(); i++)
+    {
+        wrong += mixed_result[i] != mixed_expected[i];
+    }
+    report(testNum++, "Forty mixed instances (batch)", wrong == 0, "every instance right", wrong);
+}